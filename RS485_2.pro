@@ -5,11 +5,32 @@ QT += network
 CONFIG += c++17 cmdline
 
 DEFINES += PROJECT_DIR=\\\"$$PWD\\\"
+# Trace messages (per chunk/packet hex dumps) are compiled out of release builds
+CONFIG(release, debug|release): DEFINES += LOG_COMPILE_LEVEL=1
 
 SOURCES += \
+        ber.cpp \
+        capture.cpp \
+        framequeue.cpp \
+        gateway.cpp \
+        histogram.cpp \
+        log.cpp \
         main.cpp \
+        metrics.cpp \
+        metricsserver.cpp \
+        oidstore.cpp \
+        pollscheduler.cpp \
         portlistener.cpp \
-        snmpconverter.cpp
+        routecache.cpp \
+        sciframereassembler.cpp \
+        scihandlers.cpp \
+        snmpagent.cpp \
+        snmpconverter.cpp \
+        snmpnotifier.cpp \
+        snmppdu.cpp \
+        statefile.cpp \
+        udpsender.cpp \
+        updatefilter.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -17,8 +38,31 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    ber.h \
+    capture.h \
+    framequeue.h \
+    gateway.h \
+    histogram.h \
+    log.h \
+    metrics.h \
+    metricsserver.h \
+    oidstore.h \
+    pollscheduler.h \
     portlistener.h \
+    routecache.h \
+    sciframereassembler.h \
+    scicontrol.h \
+    scihandlers.h \
+    sciprotocol.h \
+    snmpagent.h \
     snmpconverter.h \
+    snmpnotifier.h \
+    snmpoids.h \
+    snmppdu.h \
+    statefile.h \
+    snmpvalue.h \
+    udpsender.h \
+    updatefilter.h
 
 DISTFILES += \
     .gitignore
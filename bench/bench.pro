@@ -0,0 +1,51 @@
+# Microbenchmarks of the decode and encode hot paths:
+#   cd bench && qmake bench.pro && make && ./rs485_bench
+QT = core
+QT += network
+
+CONFIG += c++17 cmdline release
+CONFIG -= debug
+TARGET = rs485_bench
+
+# Same as the release build of RS485_2: trace messages compiled out
+DEFINES += LOG_COMPILE_LEVEL=1
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        corpus.cpp \
+        main.cpp \
+        ../ber.cpp \
+        ../framequeue.cpp \
+        ../histogram.cpp \
+        ../log.cpp \
+        ../metrics.cpp \
+        ../oidstore.cpp \
+        ../routecache.cpp \
+        ../scihandlers.cpp \
+        ../snmpconverter.cpp \
+        ../snmpnotifier.cpp \
+        ../snmppdu.cpp \
+        ../statefile.cpp \
+        ../udpsender.cpp \
+        ../updatefilter.cpp
+
+HEADERS += \
+    corpus.h \
+    ../ber.h \
+    ../framequeue.h \
+    ../histogram.h \
+    ../log.h \
+    ../metrics.h \
+    ../oidstore.h \
+    ../routecache.h \
+    ../scihandlers.h \
+    ../sciprotocol.h \
+    ../snmpconverter.h \
+    ../snmpnotifier.h \
+    ../snmpoids.h \
+    ../snmppdu.h \
+    ../snmpvalue.h \
+    ../statefile.h \
+    ../udpsender.h \
+    ../updatefilter.h
@@ -0,0 +1,188 @@
+#include "corpus.h"
+#include <cstring>
+
+namespace {
+
+// Controller address in the high nibble of Dest/Src
+const uint8_t DEST = 0x00;
+const uint8_t CMD_STATUS = 0x8;
+
+// Small LCG: the same corpus on every run
+class Random {
+public:
+    explicit Random(uint32_t seed) : m_state(seed) {}
+    uint32_t next() {
+        m_state = m_state * 1664525u + 1013904223u;
+        return m_state >> 8;
+    }
+    uint8_t byte() { return static_cast<uint8_t>(next()); }
+    // value +- step, clamped to [low, high]
+    int drift(int value, int step, int low, int high) {
+        value += static_cast<int>(next() % (2 * step + 1)) - step;
+        return value < low ? low : value > high ? high : value;
+    }
+
+private:
+    uint32_t m_state;
+};
+
+uint8_t unitSrc(int i) {
+    return static_cast<uint8_t>(0xA + i % 3);
+}
+
+void addFrame(Corpus &corpus, int i, const uint8_t *data, int length) {
+    SciFrame frame;
+    makeFrame(frame, static_cast<uint8_t>(DEST | unitSrc(i)), CMD_STATUS, data, length);
+    corpus.frames.push_back(frame);
+}
+
+Corpus swVersion(int count, Random &random) {
+    Corpus corpus{"0x00 sw version", {}};
+    for (int i = 0; i < count; ++i) {
+        // Version changes rarely: mostly the same few strings
+        uint8_t revision = static_cast<uint8_t>(random.next() % 4);
+        uint8_t data[] = {0xFF, 0x00, 0x01, 0x02, 0x03, static_cast<uint8_t>(0x10 + revision), 0x05, 0x06,
+                          static_cast<uint8_t>('A' + revision), 'B'};
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+Corpus alarmLog(int count, Random &random) {
+    Corpus corpus{"0x05 alarm log", {}};
+    for (int i = 0; i < count; ++i) {
+        uint8_t logUnit = (random.next() % 4) == 0 ? 0x04 : 0x01; // Switches or PA
+        uint8_t eventId = static_cast<uint8_t>(0x11 + random.next() % 3); // Alarm log 1-3
+        uint8_t data[] = {0xFF, 0x05, eventId, random.byte(), random.byte(), logUnit};
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+Corpus redundantStatus(int count, Random &random) {
+    Corpus corpus{"0x06 redundant status", {}};
+    for (int i = 0; i < count; ++i) {
+        uint8_t systemStatus = (random.next() % 32) == 0 ? 0x03 : 0x01;
+        uint8_t switchStatus = (random.next() % 32) == 0 ? 0x02 : 0x01;
+        uint8_t data[] = {0xFF, 0x06, 0x00, systemStatus, switchStatus};
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+Corpus paStatus(int count, Random &random) {
+    Corpus corpus{"0x09 pa status", {}};
+    int temperature = 45;
+    int gain = 600;
+    int power = 3000;
+    for (int i = 0; i < count; ++i) {
+        temperature = random.drift(temperature, 1, -40, 90);
+        gain = random.drift(gain, 3, 0, 0xFFFF);
+        power = random.drift(power, 20, 0, 0xFFFF);
+        bool alarm = (random.next() % 64) == 0;
+        uint8_t data[] = {0xFF, 0x09, 0x00, static_cast<uint8_t>(alarm ? 0x80 : 0x00),
+                          static_cast<uint8_t>(temperature > 85 ? 0x04 : 0x00),
+                          static_cast<uint8_t>(temperature >> 8), static_cast<uint8_t>(temperature),
+                          static_cast<uint8_t>(gain >> 8), static_cast<uint8_t>(gain),
+                          static_cast<uint8_t>(power >> 8), static_cast<uint8_t>(power)};
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+Corpus switchAlarms(int count, Random &random) {
+    Corpus corpus{"0x0C switch alarms", {}};
+    for (int i = 0; i < count; ++i) {
+        bool alarm = (random.next() % 64) == 0;
+        uint8_t data[] = {0xFF, 0x0C, static_cast<uint8_t>(alarm ? 0x01 : 0x00),
+                          static_cast<uint8_t>(alarm ? 1 << (i % 3) : 0x00), static_cast<uint8_t>(alarm ? 0x04 : 0x00)};
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+Corpus frequencies(int count, Random &random) {
+    Corpus corpus{"0x17-0x19 frequency/voltage", {}};
+    int voltage = 480;
+    for (int i = 0; i < count; ++i) {
+        voltage = random.drift(voltage, 2, 0, 0xFFFF);
+        switch (i % 4) {
+        case 0: { // LO frequency and Tx band
+            uint8_t data[] = {0xFF, 0x17, 0x17, 0x32, 0xFA, 0x00, 0x00, 0x00};
+            addFrame(corpus, i, data, sizeof(data));
+            break;
+        }
+        case 1: { // IF frequency
+            uint8_t data[] = {0xFF, 0x17, 0xFF, 0x17, 0x04, 0xB0};
+            addFrame(corpus, i, data, sizeof(data));
+            break;
+        }
+        case 2: { // Output frequency
+            uint8_t data[] = {0xFF, 0x18, 0x36, 0xB0};
+            addFrame(corpus, i, data, sizeof(data));
+            break;
+        }
+        default: { // Input DC voltage
+            uint8_t data[] = {0xFF, 0x19, static_cast<uint8_t>(voltage >> 8), static_cast<uint8_t>(voltage)};
+            addFrame(corpus, i, data, sizeof(data));
+            break;
+        }
+        }
+    }
+    return corpus;
+}
+
+Corpus unmapped(int count, Random &random) {
+    Corpus corpus{"0x1A-0x20 not in MIB", {}};
+    for (int i = 0; i < count; ++i) {
+        if (i % 2 == 0) {
+            uint8_t data[] = {0xFF, static_cast<uint8_t>(0x1A + i % 6), random.byte(), random.byte()};
+            addFrame(corpus, i, data, sizeof(data));
+        } else { // MAC address
+            uint8_t data[] = {0xFF, 0x20, 0x00, 0x1B, 0x2C, random.byte(), random.byte(), random.byte()};
+            addFrame(corpus, i, data, sizeof(data));
+        }
+    }
+    return corpus;
+}
+
+Corpus hostName(int count, Random &random) {
+    Corpus corpus{"0x21 host name", {}};
+    for (int i = 0; i < count; ++i) {
+        uint8_t data[13] = {0xFF, 0x21};
+        memcpy(data + 2, "PA-GATEWAY0", 11);
+        data[12] = static_cast<uint8_t>('0' + random.next() % 3);
+        addFrame(corpus, i, data, sizeof(data));
+    }
+    return corpus;
+}
+
+} // namespace
+
+void makeFrame(SciFrame &frame, uint8_t destSrc, uint8_t cmd, const uint8_t *data, int length) {
+    frame.size = static_cast<uint8_t>(sciEncode(destSrc, cmd, data, length, frame.bytes));
+    frame.receivedNs = 0;
+}
+
+std::vector<Corpus> buildCorpora(int framesPerCorpus) {
+    Random random(0x5C1u);
+    std::vector<Corpus> corpora;
+    corpora.push_back(swVersion(framesPerCorpus, random));
+    corpora.push_back(alarmLog(framesPerCorpus, random));
+    corpora.push_back(redundantStatus(framesPerCorpus, random));
+    corpora.push_back(paStatus(framesPerCorpus, random));
+    corpora.push_back(switchAlarms(framesPerCorpus, random));
+    corpora.push_back(frequencies(framesPerCorpus, random));
+    corpora.push_back(unmapped(framesPerCorpus, random));
+    corpora.push_back(hostName(framesPerCorpus, random));
+
+    // Bus traffic: mostly status frames with the others in between
+    Corpus mixed{"mixed", {}};
+    size_t kinds = corpora.size();
+    for (int i = 0; i < framesPerCorpus; ++i) {
+        size_t kind = (i % 2 == 0) ? 3 : static_cast<size_t>(random.next() % kinds);
+        mixed.frames.push_back(corpora[kind].frames[static_cast<size_t>(i)]);
+    }
+    corpora.push_back(mixed);
+    return corpora;
+}
@@ -0,0 +1,25 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <vector>
+#include "../framequeue.h"
+
+// Frames of one kind, all valid (STX ... CRC ETX) and addressed from PA A, B and C in turn
+struct Corpus {
+    const char *name;
+    std::vector<SciFrame> frames;
+};
+
+/*
+Realistic frame corpora for every 0x8 sub-command the converter decodes:
+0x00, 0x05, 0x06, 0x09, 0x0C, 0x17 (both forms), 0x18, 0x19, 0x1A-0x1F, 0x20, 0x21,
+plus "mixed", an interleaving of all of them.
+Values drift from frame to frame (deterministic pseudo-random sequence), alarm bits
+change now and then, so update filters and alarm edge detection see real traffic.
+*/
+std::vector<Corpus> buildCorpora(int framesPerCorpus);
+
+// Fill frame with STX, Dest/Src, Cmd/Len, data, CRC and ETX
+void makeFrame(SciFrame &frame, uint8_t destSrc, uint8_t cmd, const uint8_t *data, int length);
+
+#endif // CORPUS_H
@@ -0,0 +1,472 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QUdpSocket>
+#include <functional>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include "corpus.h"
+#include "../ber.h"
+#include "../log.h"
+#include "../metrics.h"
+#include "../scihandlers.h"
+#include "../snmpconverter.h"
+
+/*
+Microbenchmarks of the decode and encode hot paths.
+Every case runs for at least --time-ms after one warm-up pass and reports per
+operation (a frame for the converter cases):
+  ns       wall time
+  allocs   heap allocations (malloc/calloc/realloc, Qt containers included)
+  alloc B  bytes requested from the heap
+  out B    datagram bytes handed to the sink or the socket
+By default the UDP sockets are replaced by an in-memory sink, so only the CPU
+cost of decode, filter, encode and queueing is measured; --udp PORT sends to
+127.0.0.1:PORT through the real socket (sendmmsg) instead.
+"udp loopback" drives one UdpSender alone through the real socket, to a local
+receiver that is drained in the loop (or to --udp PORT), and prints datagrams/s
+and datagrams per syscall; with --udp the converter cases print them too.
+*/
+
+// Heap usage of the whole process: glibc malloc wrappers, operator new ends up here too
+static std::atomic<uint64_t> s_allocations{0};
+static std::atomic<uint64_t> s_allocatedBytes{0};
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(count * size, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+#endif
+
+namespace {
+
+// Results of the micro loops end up here so the compiler cannot drop them
+volatile uint32_t g_consumed;
+
+struct Options {
+    int64_t minNs = 300 * 1000000LL;
+    int framesPerCorpus = 1024;
+    int batch = 16;         // Frames per processQueuedFrames(), like one readyRead burst
+    int destinations = 1;
+    int version = SNMP_VERSION_1;
+    bool filter = false;    // UpdateFilter with its defaults
+    quint16 udpPort = 0;    // 0 - in-memory sink
+    QString only;           // Run cases whose name contains this
+};
+
+struct Measurement {
+    uint64_t ops = 0;
+    int64_t ns = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t outBytes = 0;
+};
+
+class MemorySink : public DatagramSink {
+public:
+    void write(const char *data, int size, const QHostAddress &address, quint16 port) override {
+        Q_UNUSED(address);
+        Q_UNUSED(port);
+        ++datagrams;
+        bytes += static_cast<uint64_t>(size);
+        last = static_cast<uint8_t>(data[size - 1]);
+    }
+
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    uint8_t last = 0;
+};
+
+// Varbinds of the handler cases: counted, nothing stored or encoded
+class CountingOutput : public SciOutput {
+public:
+    void addVarbind(const SnmpOid &oid, const SnmpValue &value) override {
+        ++varbinds;
+        sum += oid.length + value.number;
+    }
+    void addAlarmVarbind(const SnmpOid &oid, const SnmpValue &value, uint8_t src) override {
+        addVarbind(oid, value);
+        sum += src;
+    }
+
+    uint64_t varbinds = 0;
+    uint32_t sum = 0;
+};
+
+/*
+Run body (one batch, returns operations done) once to warm up, then until minNs passed.
+outBytes, if given, is read before and after like the heap counters
+*/
+template <typename Body>
+Measurement measure(const Options &options, Body body, const std::function<uint64_t()> &outBytes = nullptr) {
+    body();
+    Measurement result;
+    uint64_t allocations = s_allocations.load(std::memory_order_relaxed);
+    uint64_t allocatedBytes = s_allocatedBytes.load(std::memory_order_relaxed);
+    uint64_t out = outBytes ? outBytes() : 0;
+    int64_t start = Metrics::now();
+    do {
+        result.ops += static_cast<uint64_t>(body());
+        result.ns = Metrics::now() - start;
+    } while (result.ns < options.minNs);
+    result.allocations = s_allocations.load(std::memory_order_relaxed) - allocations;
+    result.allocatedBytes = s_allocatedBytes.load(std::memory_order_relaxed) - allocatedBytes;
+    result.outBytes = outBytes ? outBytes() - out : 0;
+    return result;
+}
+
+void printHeader(const Options &options) {
+    printf("frames per corpus %d, batch %d, destinations %d, SNMP v%s, filter %s, output %s\n",
+           options.framesPerCorpus, options.batch, options.destinations,
+           options.version == SNMP_VERSION_1 ? "1" : "2c", options.filter ? "on" : "off",
+           options.udpPort ? qPrintable(QString("udp 127.0.0.1:%1").arg(options.udpPort)) : "memory sink");
+    printf("%-36s %10s %10s %10s %10s\n", "benchmark (per op)", "ns", "allocs", "alloc B", "out B");
+}
+
+void printResult(const char *name, const Measurement &m) {
+    double ops = m.ops ? static_cast<double>(m.ops) : 1.0;
+    printf("%-36s %10.1f %10.3f %10.1f %10.1f\n", name, m.ns / ops, m.allocations / ops, m.allocatedBytes / ops,
+           m.outBytes / ops);
+    fflush(stdout);
+}
+
+// Socket side of a case: throughput and how well sendmmsg() batched
+void printSocket(const Measurement &m, uint64_t datagrams, double perSyscall) {
+    double seconds = m.ns > 0 ? m.ns / 1e9 : 1.0;
+    printf("%-36s %10.0f datagrams/s, %.1f datagrams per syscall\n", "", datagrams / seconds, perSyscall);
+    fflush(stdout);
+}
+
+bool selected(const Options &options, const char *name) {
+    return options.only.isEmpty() || QString(name).contains(options.only, Qt::CaseInsensitive);
+}
+
+// Cost of the building blocks on their own
+void runMicro(const Options &options, const Corpus &mixed) {
+    const std::vector<SciFrame> &frames = mixed.frames;
+    const int n = static_cast<int>(frames.size());
+    const int loop = 1024;
+
+    if (selected(options, "sciDecode")) {
+        printResult("sciDecode", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                const SciFrame &frame = frames[i % n];
+                SCIPacket packet;
+                if (sciDecode(frame.bytes, frame.size, packet) == SciStatus::Ok) {
+                    sum += packet.len;
+                }
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+    if (selected(options, "sciCrc")) {
+        printResult("sciCrc", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                const SciFrame &frame = frames[i % n];
+                sum += sciCrc(frame.bytes, frame.size);
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+
+    uint8_t buffer[64];
+    BerWriter writer(buffer, sizeof(buffer));
+    if (selected(options, "BerWriter::writeInteger")) {
+        printResult("BerWriter::writeInteger", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                writer.reset();
+                // 1 to 4 content bytes, both signs
+                writer.writeInteger(static_cast<int32_t>(i * 2654435761u) >> (i % 32));
+                sum += static_cast<uint32_t>(writer.length());
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+    if (selected(options, "BerWriter::writeLength")) {
+        printResult("BerWriter::writeLength", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                writer.reset();
+                // Short and long forms as they occur in messages
+                writer.writeLength((i * 37) % 1500);
+                sum += static_cast<uint32_t>(writer.length());
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+
+    if (selected(options, "SnmpPduBuilder 6 varbinds")) {
+        // The message of one 0x09 frame
+        SnmpPduBuilder pdu("public", options.version);
+        const SnmpOid *oids = UNIT_OIDS.oid[0];
+        const UnitParam params[] = {PARAM_MUTE, PARAM_SUMMARY_ALARM, PARAM_TEMP_ALARM, PARAM_TEMPERATURE, PARAM_GAIN, PARAM_POWER};
+        uint32_t requestId = 1;
+        printResult("SnmpPduBuilder 6 varbinds", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                for (int p = 0; p < 6; ++p) {
+                    pdu.add(oids[params[p]], SnmpValue::integer(i * (p + 1)));
+                }
+                pdu.build(requestId++);
+                sum += static_cast<uint32_t>(pdu.size());
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+}
+
+// Table lookup and every SCI_HANDLERS entry on its own, over the frames of the mixed corpus
+void runHandlers(const Options &options, const Corpus &mixed) {
+    struct Decoded {
+        SCIPacket packet;
+        SciSource source;
+    };
+    std::vector<Decoded> decoded;
+    for (const SciFrame &frame : mixed.frames) {
+        Decoded entry;
+        if (sciDecode(frame.bytes, frame.size, entry.packet) != SciStatus::Ok) {
+            continue;
+        }
+        uint8_t src = entry.packet.destSrc & 0x0F;
+        int unit = sciUnitIndex(src);
+        if (unit >= 0) {
+            entry.source = SciSource{src, unit, UNIT_OIDS.oid[unit]};
+            decoded.push_back(entry);
+        }
+    }
+    const int n = static_cast<int>(decoded.size());
+    const int loop = 1024;
+    if (n == 0) {
+        return;
+    }
+
+    if (selected(options, "sciFindHandler")) {
+        printResult("sciFindHandler", measure(options, [&]() {
+            uint32_t sum = 0;
+            for (int i = 0; i < loop; ++i) {
+                const SciCommandHandler *handler = sciFindHandler(decoded[i % n].packet);
+                sum += handler ? handler->minLength : 0;
+            }
+            g_consumed = sum;
+            return loop;
+        }));
+    }
+
+    CountingOutput out;
+    for (const SciCommandHandler &handler : SCI_HANDLERS) {
+        QString name = QString("handler %1 %2").arg(handler.subCommand, 2, 16, QChar('0')).arg(handler.name);
+        if (!selected(options, qPrintable(name))) {
+            continue;
+        }
+        std::vector<Decoded> own;
+        for (const Decoded &entry : decoded) {
+            if (sciFindHandler(entry.packet) == &handler && entry.packet.len >= handler.minLength) {
+                own.push_back(entry);
+            }
+        }
+        if (own.empty()) {
+            continue; // Not in the corpus
+        }
+        const int count = static_cast<int>(own.size());
+        printResult(qPrintable(name), measure(options, [&]() {
+            for (int i = 0; i < loop; ++i) {
+                const Decoded &entry = own[i % count];
+                handler.handle(entry.packet, entry.source, out);
+            }
+            g_consumed = out.sum;
+            return loop;
+        }));
+    }
+}
+
+// Full path: frame queue -> processQueuedFrames() -> decode, store, filter, PDU -> sender
+void runConverter(const Options &options, const Corpus &corpus) {
+    QString name = "convert " + QString(corpus.name);
+    if (!selected(options, qPrintable(name))) {
+        return;
+    }
+    // The gateway makes every destination reachable regardless of local interfaces
+    SnmpConverter converter(QHostAddress("255.255.255.0"), QHostAddress(QHostAddress::LocalHost));
+    for (int i = 0; i < options.destinations; ++i) {
+        DestinationConfig destination;
+        destination.address = QHostAddress(QHostAddress::LocalHost);
+        destination.port = options.udpPort ? options.udpPort : static_cast<quint16>(16161 + i);
+        destination.version = options.version;
+        converter.addDestination(destination);
+    }
+    MemorySink sink;
+    if (options.udpPort == 0) {
+        converter.setSink(&sink);
+    }
+    converter.filter().setEnabled(options.filter);
+    FrameQueue queue(options.batch);
+    converter.addFrameSource(&queue);
+
+    const std::vector<SciFrame> &frames = corpus.frames;
+    size_t position = 0;
+    auto sent = [&](bool bytes) {
+        uint64_t total = 0;
+        for (int i = 0; i < converter.destinationCount(); ++i) {
+            total += bytes ? converter.sender(i)->bytes() : converter.sender(i)->datagrams();
+        }
+        return total;
+    };
+    uint64_t datagramsBefore = 0;
+    bool started = false;
+    Measurement result = measure(options, [&]() {
+        for (int i = 0; i < options.batch; ++i) {
+            const SciFrame &frame = frames[position];
+            queue.push(frame.bytes, frame.size);
+            position = (position + 1) % frames.size();
+        }
+        converter.processQueuedFrames();
+        return options.batch;
+    }, [&]() {
+        if (!started) { // Read once before the measured loop: datagrams of the warm-up do not count
+            started = true;
+            datagramsBefore = sent(false);
+        }
+        return options.udpPort ? sent(true) : sink.bytes;
+    });
+    printResult(qPrintable(name), result);
+    if (options.udpPort) {
+        printSocket(result, sent(false) - datagramsBefore, converter.sender(0)->datagramsPerSyscall());
+    }
+}
+
+/*
+UdpSender on its own: batch datagrams of the size of one 0x09 message are queued
+and sent with one flush() (one sendmmsg() on Linux) to 127.0.0.1
+*/
+void runUdp(const Options &options) {
+    const char *name = "udp loopback";
+    if (!selected(options, name)) {
+        return;
+    }
+    // A local receiver drained in the loop, so its socket buffer never overflows
+    QUdpSocket receiver;
+    quint16 port = options.udpPort;
+    if (port == 0) {
+        if (!receiver.bind(QHostAddress(QHostAddress::LocalHost), 0)) {
+            printf("%-36s cannot bind a receiver: %s\n", name, qPrintable(receiver.errorString()));
+            return;
+        }
+        port = receiver.localPort();
+    }
+    SnmpPduBuilder pdu("public", options.version);
+    const SnmpOid *oids = UNIT_OIDS.oid[0];
+    const UnitParam params[] = {PARAM_MUTE, PARAM_SUMMARY_ALARM, PARAM_TEMP_ALARM, PARAM_TEMPERATURE, PARAM_GAIN, PARAM_POWER};
+    for (int p = 0; p < 6; ++p) {
+        pdu.add(oids[params[p]], SnmpValue::integer(p));
+    }
+    pdu.build(1);
+
+    UdpSender sender(qMax(options.batch, UdpSender::DEFAULT_CAPACITY));
+    const QHostAddress address(QHostAddress::LocalHost);
+    char buffer[UdpSender::MAX_DATAGRAM_SIZE];
+    uint64_t received = 0;
+    uint64_t datagramsBefore = 0;
+    bool started = false;
+    Measurement result = measure(options, [&]() {
+        for (int i = 0; i < options.batch; ++i) {
+            sender.queue(pdu.data(), pdu.size(), address, port);
+        }
+        sender.flush();
+        while (options.udpPort == 0 && receiver.hasPendingDatagrams()) {
+            if (receiver.readDatagram(buffer, sizeof(buffer)) > 0) {
+                ++received;
+            }
+        }
+        return options.batch;
+    }, [&]() {
+        if (!started) {
+            started = true;
+            datagramsBefore = sender.datagrams();
+        }
+        return sender.bytes();
+    });
+    printResult(name, result);
+    printSocket(result, sender.datagrams() - datagramsBefore, sender.datagramsPerSyscall());
+    if (options.udpPort == 0) {
+        printf("%-36s %10llu received, %llu errors\n", "", static_cast<unsigned long long>(received),
+               static_cast<unsigned long long>(sender.errors()));
+    }
+}
+
+void usage() {
+    printf("Usage: rs485_bench [--time-ms N] [--frames N] [--batch N] [--destinations N] [--v2c] [--filter]\n"
+           "                   [--udp PORT] [--only TEXT]\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    // Warnings only: debug output would be measured too
+    Log::setLevel(LOG_LEVEL_WARNING);
+
+    Options options;
+    QStringList args = a.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        const QString &arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (arg == "--time-ms" && hasValue) {
+            options.minNs = args[++i].toLongLong() * 1000000LL;
+        } else if (arg == "--frames" && hasValue) {
+            options.framesPerCorpus = qMax(1, args[++i].toInt());
+        } else if (arg == "--batch" && hasValue) {
+            options.batch = qMax(1, args[++i].toInt());
+        } else if (arg == "--destinations" && hasValue) {
+            options.destinations = qMax(1, args[++i].toInt());
+        } else if (arg == "--udp" && hasValue) {
+            options.udpPort = static_cast<quint16>(args[++i].toUInt());
+        } else if (arg == "--only" && hasValue) {
+            options.only = args[++i];
+        } else if (arg == "--v2c") {
+            options.version = SNMP_VERSION_2C;
+        } else if (arg == "--filter") {
+            options.filter = true;
+        } else {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::vector<Corpus> corpora = buildCorpora(options.framesPerCorpus);
+    printHeader(options);
+    runMicro(options, corpora.back());
+    runHandlers(options, corpora.back());
+    for (const Corpus &corpus : corpora) {
+        runConverter(options, corpus);
+    }
+    runUdp(options);
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "ber.h"
+
+BerWriter::BerWriter(uint8_t *buffer, int capacity)
+    : m_buffer(buffer), m_capacity(capacity), m_position(capacity) {
+}
+
+void BerWriter::reset() {
+    m_position = m_capacity;
+    m_overflow = false;
+}
+
+bool BerWriter::reserve(int size) {
+    if (m_overflow || size > m_position) {
+        m_overflow = true;
+        return false;
+    }
+    m_position -= size;
+    return true;
+}
+
+void BerWriter::writeByte(uint8_t byte) {
+    if (reserve(1)) {
+        m_buffer[m_position] = byte;
+    }
+}
+
+void BerWriter::writeBytes(const uint8_t *bytes, int size) {
+    if (reserve(size)) {
+        for (int i = 0; i < size; ++i) {
+            m_buffer[m_position + i] = bytes[i];
+        }
+    }
+}
+
+void BerWriter::writeLength(int length) {
+    int size = berLengthSize(length);
+    if (!reserve(size)) {
+        return;
+    }
+    if (size == 1) {
+        m_buffer[m_position] = static_cast<uint8_t>(length);
+        return;
+    }
+    // Long form: 0x80 | number of length bytes, then the length big-endian
+    m_buffer[m_position] = static_cast<uint8_t>(0x80 | (size - 1));
+    for (int i = size - 1; i > 0; --i) {
+        m_buffer[m_position + i] = static_cast<uint8_t>(length & 0xFF);
+        length >>= 8;
+    }
+}
+
+void BerWriter::writeHeader(uint8_t tag, int contentLength) {
+    writeLength(contentLength);
+    writeByte(tag);
+}
+
+void BerWriter::writeInteger(int32_t value) {
+    int size = berIntegerSize(value);
+    if (reserve(size)) {
+        uint32_t bits = static_cast<uint32_t>(value); // Two's complement, big-endian
+        for (int i = size - 1; i >= 0; --i) {
+            m_buffer[m_position + i] = static_cast<uint8_t>(bits & 0xFF);
+            bits >>= 8;
+        }
+    }
+    writeHeader(BER_INTEGER, size);
+}
+
+void BerWriter::writeUnsigned(uint8_t tag, uint32_t value) {
+    int size = berUnsignedSize(value);
+    if (reserve(size)) {
+        // A fifth byte (if any) stays 0x00 so the value is not read as negative
+        uint64_t bits = value;
+        for (int i = size - 1; i >= 0; --i) {
+            m_buffer[m_position + i] = static_cast<uint8_t>(bits & 0xFF);
+            bits >>= 8;
+        }
+    }
+    writeHeader(tag, size);
+}
+
+void BerWriter::writeOctetString(const char *bytes, int size) {
+    writeBytes(reinterpret_cast<const uint8_t*>(bytes), size);
+    writeHeader(BER_OCTET_STRING, size);
+}
+
+void BerWriter::writeNull() {
+    writeHeader(BER_NULL, 0);
+}
+
+void BerWriter::writeOid(const SnmpOid &oid) {
+    writeBytes(oid.bytes, oid.length);
+    writeHeader(BER_OID, oid.length);
+}
+
+BerReader::BerReader(const uint8_t *data, int size) : m_data(data), m_size(size) {
+}
+
+bool BerReader::readElement(uint8_t &tag, const uint8_t *&contents, int &length) {
+    if (m_error || m_size - m_position < 2) {
+        return fail();
+    }
+    tag = m_data[m_position++];
+    if ((tag & 0x1F) == 0x1F) {
+        return fail(); // Multi-byte tags are not used by SNMP
+    }
+    int first = m_data[m_position++];
+    if (first < 0x80) {
+        length = first;
+    } else {
+        // Long form; 0x80 (indefinite) is not allowed in SNMP
+        int count = first & 0x7F;
+        if (count == 0 || count > 3 || m_size - m_position < count) {
+            return fail();
+        }
+        length = 0;
+        for (int i = 0; i < count; ++i) {
+            length = (length << 8) | m_data[m_position++];
+        }
+    }
+    if (length > m_size - m_position) {
+        return fail();
+    }
+    contents = m_data + m_position;
+    m_position += length;
+    return true;
+}
+
+bool BerReader::enter(uint8_t tag, BerReader &contents) {
+    uint8_t elementTag;
+    const uint8_t *bytes;
+    int length;
+    if (!readElement(elementTag, bytes, length)) {
+        return false;
+    }
+    if (elementTag != tag) {
+        return fail();
+    }
+    contents = BerReader(bytes, length);
+    return true;
+}
+
+bool BerReader::readInteger(int32_t &value) {
+    uint8_t tag;
+    const uint8_t *bytes;
+    int length;
+    if (!readElement(tag, bytes, length)) {
+        return false;
+    }
+    if (tag != BER_INTEGER || length < 1 || length > 4) {
+        return fail();
+    }
+    // Sign-extend the first byte, then shift in the rest
+    uint32_t bits = (bytes[0] & 0x80) ? 0xFFFFFFFFu : 0;
+    for (int i = 0; i < length; ++i) {
+        bits = (bits << 8) | bytes[i];
+    }
+    value = static_cast<int32_t>(bits);
+    return true;
+}
+
+bool BerReader::readOctetString(const uint8_t *&bytes, int &length) {
+    uint8_t tag;
+    if (!readElement(tag, bytes, length)) {
+        return false;
+    }
+    if (tag != BER_OCTET_STRING) {
+        return fail();
+    }
+    return true;
+}
+
+bool BerReader::readOid(SnmpOid &oid) {
+    uint8_t tag;
+    const uint8_t *bytes;
+    int length;
+    if (!readElement(tag, bytes, length)) {
+        return false;
+    }
+    if (tag != BER_OID || length < 1 || length > SNMP_OID_MAX_LENGTH) {
+        return fail();
+    }
+    oid.length = static_cast<uint8_t>(length);
+    for (int i = 0; i < length; ++i) {
+        oid.bytes[i] = bytes[i];
+    }
+    return true;
+}
+
+bool BerReader::skip() {
+    uint8_t tag;
+    const uint8_t *bytes;
+    int length;
+    return readElement(tag, bytes, length);
+}
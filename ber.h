@@ -0,0 +1,148 @@
+#ifndef BER_H
+#define BER_H
+
+#include <cstdint>
+#include "snmpoids.h"
+
+// BER tags used by SNMP
+const uint8_t BER_INTEGER = 0x02;
+const uint8_t BER_OCTET_STRING = 0x04;
+const uint8_t BER_NULL = 0x05;
+const uint8_t BER_OID = 0x06;
+const uint8_t BER_SEQUENCE = 0x30;
+// SNMP application types
+const uint8_t BER_IP_ADDRESS = 0x40;
+const uint8_t BER_COUNTER32 = 0x41;
+const uint8_t BER_GAUGE32 = 0x42;
+const uint8_t BER_TIMETICKS = 0x43;
+// SNMPv2 exception values (varbind value with empty contents)
+const uint8_t BER_NO_SUCH_OBJECT = 0x80;
+const uint8_t BER_NO_SUCH_INSTANCE = 0x81;
+const uint8_t BER_END_OF_MIB_VIEW = 0x82;
+
+// Number of bytes taken by a definite length field
+inline int berLengthSize(int length) {
+    if (length < 0x80) return 1;
+    if (length <= 0xFF) return 2;
+    if (length <= 0xFFFF) return 3;
+    if (length <= 0xFFFFFF) return 4;
+    return 5;
+}
+
+// Number of content bytes of a two's complement INTEGER
+inline int berIntegerSize(int32_t value) {
+    int size = 1;
+    while (size < 4) {
+        // Stop when the remaining high bytes are pure sign extension
+        int32_t high = value >> (8 * size - 1);
+        if (high == 0 || high == -1) break;
+        ++size;
+    }
+    return size;
+}
+
+// Number of content bytes of an unsigned 32-bit value (Counter32, Gauge32, TimeTicks)
+inline int berUnsignedSize(uint32_t value) {
+    int size = 1;
+    while (size < 5 && (value >> (8 * size - 1)) != 0) {
+        ++size;
+    }
+    return size;
+}
+
+// Size of a complete TLV with contentLength bytes of contents
+inline int berTlvSize(int contentLength) {
+    return 1 + berLengthSize(contentLength) + contentLength;
+}
+
+/*
+BER encoder that writes backwards into a caller-provided buffer.
+Contents are written first, then their definite length and tag, so lengths of
+any size are known exactly and nothing is patched or moved afterwards.
+Encoding never allocates: the buffer is a fixed array (stack or member).
+Elements must be written in reverse order: the last element of a sequence first.
+>int mark = w.length();
+>w.writeInteger(value);
+>w.writeOid(oid);
+>w.closeConstructed(BER_SEQUENCE, mark); // SEQUENCE { oid, value }
+If the buffer is too small, overflow() becomes true and further writes are ignored.
+*/
+class BerWriter {
+public:
+    BerWriter(uint8_t *buffer, int capacity);
+
+    // Encoded data starts here (valid until the buffer is reused)
+    const uint8_t *data() const { return m_buffer + m_position; }
+    // Number of bytes written so far
+    int length() const { return m_capacity - m_position; }
+    bool overflow() const { return m_overflow; }
+    // Start over with an empty buffer
+    void reset();
+
+    void writeByte(uint8_t byte);
+    void writeBytes(const uint8_t *bytes, int size);
+    void writeLength(int length);
+    // Tag and length of an element whose contents (contentLength bytes) are already written
+    void writeHeader(uint8_t tag, int contentLength);
+    // Close a constructed element opened at mark = length()
+    void closeConstructed(uint8_t tag, int mark) { writeHeader(tag, length() - mark); }
+
+    void writeInteger(int32_t value);
+    void writeOctetString(const char *bytes, int size);
+    void writeNull();
+    void writeOid(const SnmpOid &oid);
+    void writeCounter32(uint32_t value) { writeUnsigned(BER_COUNTER32, value); }
+    void writeGauge32(uint32_t value) { writeUnsigned(BER_GAUGE32, value); }
+    void writeTimeTicks(uint32_t value) { writeUnsigned(BER_TIMETICKS, value); }
+    // Unsigned 32-bit value with an arbitrary application tag
+    void writeUnsigned(uint8_t tag, uint32_t value);
+
+private:
+    uint8_t *m_buffer;
+    int m_capacity;
+    int m_position; // Index of the first written byte; writing moves it towards 0
+    bool m_overflow = false;
+
+    bool reserve(int size);
+};
+
+/*
+BER decoder over a received message, reads forwards and never copies:
+strings are returned as pointers into the message.
+Constructed elements are read with enter(), which gives a reader limited
+to the element contents and moves this reader past the element.
+Any malformed element (truncated, indefinite or too long length) sets
+error() and makes further reads fail.
+*/
+class BerReader {
+public:
+    BerReader(const uint8_t *data = nullptr, int size = 0);
+
+    bool atEnd() const { return m_position >= m_size; }
+    bool error() const { return m_error; }
+    // Tag of the next element, 0 at the end
+    uint8_t peekTag() const { return atEnd() ? 0 : m_data[m_position]; }
+
+    // Next element of any type: tag and contents
+    bool readElement(uint8_t &tag, const uint8_t *&contents, int &length);
+    // Next element must be a constructed element with the given tag
+    bool enter(uint8_t tag, BerReader &contents);
+    bool readInteger(int32_t &value);
+    bool readOctetString(const uint8_t *&bytes, int &length);
+    // Fails for OIDs longer than SNMP_OID_MAX_LENGTH
+    bool readOid(SnmpOid &oid);
+    bool skip();
+
+private:
+    const uint8_t *m_data;
+    int m_size;
+    int m_position = 0;
+    bool m_error = false;
+
+    bool fail() {
+        m_error = true;
+        return false;
+    }
+};
+
+#endif // BER_H
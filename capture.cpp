@@ -0,0 +1,325 @@
+#include "capture.h"
+#include <cstring>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+CaptureRecorder::CaptureRecorder(QObject *parent) : QObject(parent), m_file(this) {
+}
+
+bool CaptureRecorder::open(const QString &fileName) {
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    m_file.write("# RS485 capture: <microseconds since the first read> <bytes in hex>\n");
+    m_file.flush();
+    m_clock.invalidate();
+    return true;
+}
+
+void CaptureRecorder::close() {
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+void CaptureRecorder::write(const uint8_t *data, int size) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    if (!m_clock.isValid()) {
+        m_clock.start();
+    }
+    char line[512];
+    int length = qsnprintf(line, sizeof(line), "%lld ", static_cast<long long>(m_clock.nsecsElapsed() / 1000));
+    for (int i = 0; i < size; ++i) {
+        if (length + 3 > static_cast<int>(sizeof(line))) {
+            m_file.write(line, length);
+            length = 0;
+        }
+        line[length++] = HEX_DIGITS[data[i] >> 4];
+        line[length++] = HEX_DIGITS[data[i] & 0x0F];
+    }
+    line[length++] = '\n';
+    m_file.write(line, length);
+    m_file.flush();
+}
+
+CaptureReplay::CaptureReplay(const QString &fileName, double speed, QObject *parent)
+    : QIODevice(parent), m_fileName(fileName), m_speed(speed > 0 ? speed : 0), m_timer(this) {
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &CaptureReplay::release);
+}
+
+double CaptureReplay::speedFromString(const QString &text, bool *ok) {
+    QString value = text.trimmed().toLower();
+    if (value == "max") {
+        if (ok) *ok = true;
+        return 0;
+    }
+    if (value.endsWith("x")) {
+        value.chop(1);
+    }
+    bool valid = false;
+    double speed = value.toDouble(&valid);
+    valid = valid && speed > 0;
+    if (ok) *ok = valid;
+    return valid ? speed : 1.0;
+}
+
+bool CaptureReplay::open(OpenMode mode) {
+    if ((mode & WriteOnly) != 0) {
+        setErrorString("Capture replay is read-only");
+        return false;
+    }
+    if (!load()) {
+        return false;
+    }
+    m_nextChunk = 0;
+    m_readPosition = 0;
+    m_released = 0;
+    m_finished = false;
+    // Unbuffered: readData() copies straight into the reader's buffer
+    if (!QIODevice::open(mode | Unbuffered)) {
+        return false;
+    }
+    m_clock.start();
+    m_timer.start(0);
+    return true;
+}
+
+void CaptureReplay::close() {
+    m_timer.stop();
+    QIODevice::close();
+}
+
+qint64 CaptureReplay::bytesAvailable() const {
+    return static_cast<qint64>(m_released - m_readPosition) + QIODevice::bytesAvailable();
+}
+
+bool CaptureReplay::atEnd() const {
+    return m_finished;
+}
+
+bool CaptureReplay::load() {
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setErrorString("Cannot open capture " + m_fileName + ": " + file.errorString());
+        return false;
+    }
+    QByteArray content = file.readAll();
+    m_bytes.clear();
+    m_chunks.clear();
+    m_bytes.reserve(static_cast<size_t>(content.size() / 2));
+
+    const char *position = content.constData();
+    const char *end = position + content.size();
+    int lineNumber = 0;
+    qint64 firstOffset = -1;
+    qint64 previousOffset = 0;
+    while (position < end) {
+        const char *lineEnd = static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        ++lineNumber;
+        const char *p = position;
+        position = lineEnd + 1;
+        while (p < lineEnd && isSpace(*p)) {
+            ++p;
+        }
+        if (p == lineEnd || *p == '#') {
+            continue;
+        }
+
+        // Offset in microseconds, then the bytes
+        qint64 offset = 0;
+        const char *digits = p;
+        while (p < lineEnd && *p >= '0' && *p <= '9') {
+            offset = offset * 10 + (*p++ - '0');
+        }
+        bool valid = p != digits && p < lineEnd && isSpace(*p);
+        size_t chunkStart = m_bytes.size();
+        while (valid && p < lineEnd) {
+            if (isSpace(*p)) {
+                ++p;
+                continue;
+            }
+            int high = hexValue(*p++);
+            int low = p < lineEnd ? hexValue(*p++) : -1;
+            if (high < 0 || low < 0) {
+                valid = false;
+                break;
+            }
+            m_bytes.push_back(static_cast<uint8_t>((high << 4) | low));
+        }
+        if (!valid || m_bytes.size() == chunkStart) {
+            setErrorString(QString("%1:%2: expected \"<microseconds> <hex bytes>\"").arg(m_fileName).arg(lineNumber));
+            return false;
+        }
+        if (firstOffset < 0) {
+            firstOffset = offset;
+        }
+        // Offsets relative to the first chunk, never going back in time
+        offset -= firstOffset;
+        if (offset < previousOffset) {
+            offset = previousOffset;
+        }
+        previousOffset = offset;
+        m_chunks.push_back(Chunk{offset, m_bytes.size()});
+    }
+    if (m_chunks.empty()) {
+        setErrorString("Capture " + m_fileName + " has no data");
+        return false;
+    }
+    return true;
+}
+
+qint64 CaptureReplay::readData(char *data, qint64 maxSize) {
+    size_t available = m_released - m_readPosition;
+    size_t size = static_cast<size_t>(maxSize) < available ? static_cast<size_t>(maxSize) : available;
+    memcpy(data, m_bytes.data() + m_readPosition, size);
+    m_readPosition += size;
+    if (m_readPosition == m_released && !m_timer.isActive()) {
+        // Everything released has been taken: continue from the event loop, once the
+        // reader has handled this data (replayFinished() must not overtake its frames)
+        m_timer.start(0);
+    }
+    return static_cast<qint64>(size);
+}
+
+qint64 CaptureReplay::writeData(const char *data, qint64 maxSize) {
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+void CaptureReplay::release() {
+    if (!isOpen()) {
+        return;
+    }
+    size_t released = m_released;
+    if (m_speed <= 0) {
+        // One burst, at least one chunk
+        size_t limit = m_readPosition + MAX_BURST_BYTES;
+        while (m_nextChunk < m_chunks.size() && (m_released == released || m_chunks[m_nextChunk].end <= limit)) {
+            m_released = m_chunks[m_nextChunk++].end;
+        }
+    } else {
+        qint64 nowUs = static_cast<qint64>(m_clock.nsecsElapsed() / 1000 * m_speed);
+        while (m_nextChunk < m_chunks.size() && m_chunks[m_nextChunk].offsetUs <= nowUs) {
+            m_released = m_chunks[m_nextChunk++].end;
+        }
+    }
+    if (m_released != released) {
+        emit readyRead();
+    }
+    if (!m_timer.isActive()) {
+        schedule();
+    }
+}
+
+void CaptureReplay::schedule() {
+    if (m_nextChunk >= m_chunks.size()) {
+        if (m_readPosition == m_released && !m_finished) {
+            m_finished = true;
+            emit replayFinished();
+        }
+        return;
+    }
+    if (m_speed <= 0) {
+        // Next burst once the reader has taken this one
+        if (m_readPosition == m_released) {
+            m_timer.start(0);
+        }
+        return;
+    }
+    double dueUs = m_chunks[m_nextChunk].offsetUs / m_speed;
+    double waitUs = dueUs - m_clock.nsecsElapsed() / 1000.0;
+    m_timer.start(waitUs > 0 ? static_cast<int>(waitUs / 1000) + 1 : 0);
+}
+
+void DatagramCapture::write(const char *data, int size, const QHostAddress &address, quint16 port) {
+    Stream *stream = nullptr;
+    for (Stream &known : m_streams) {
+        if (known.port == port && known.address == address) {
+            stream = &known;
+            break;
+        }
+    }
+    if (!stream) {
+        Stream added;
+        added.address = address;
+        added.port = port;
+        added.prefix = address.toString().toLatin1() + ":" + QByteArray::number(port) + " ";
+        m_streams.append(added);
+        stream = &m_streams.last();
+    }
+    QByteArray &text = stream->text;
+    text.append(stream->prefix);
+    int start = text.size();
+    text.resize(start + 2 * size + 1);
+    char *out = text.data() + start;
+    for (int i = 0; i < size; ++i) {
+        uint8_t byte = static_cast<uint8_t>(data[i]);
+        *out++ = HEX_DIGITS[byte >> 4];
+        *out++ = HEX_DIGITS[byte & 0x0F];
+    }
+    *out = '\n';
+    ++m_datagrams;
+    m_bytes += static_cast<uint64_t>(size);
+}
+
+QByteArray DatagramCapture::text() const {
+    QByteArray result;
+    for (const Stream &stream : m_streams) {
+        result.append(stream.text);
+    }
+    return result;
+}
+
+bool DatagramCapture::save(const QString &fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QByteArray content = text();
+    return file.write(content) == content.size();
+}
+
+int DatagramCapture::compare(const QString &goldenFile) const {
+    QFile file(goldenFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    QByteArray golden = file.readAll();
+    QByteArray actual = text();
+    int line = 1;
+    int common = qMin(golden.size(), actual.size());
+    for (int i = 0; i < common; ++i) {
+        if (golden[i] != actual[i]) {
+            return line;
+        }
+        if (actual[i] == '\n') {
+            ++line;
+        }
+    }
+    return golden.size() == actual.size() ? 0 : line;
+}
@@ -0,0 +1,133 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <QHostAddress>
+#include <vector>
+#include "udpsender.h"
+
+/*
+Capture file of serial traffic, one read() per line:
+># comment
+><microseconds since the first read> <bytes in hex>
+>0 7e0a8bff0900000000...
+Written by CaptureRecorder ([SerialPort] captureFile), played back by CaptureReplay.
+*/
+
+// Appends every chunk read from a port to a capture file
+class CaptureRecorder : public QObject {
+    Q_OBJECT
+public:
+    explicit CaptureRecorder(QObject *parent = nullptr);
+
+    // Create (truncate) the file; false and errorString() on failure
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+    // One line per chunk, flushed at once so a crash keeps everything before it
+    void write(const uint8_t *data, int size);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock; // Started by the first chunk
+};
+
+/*
+Plays a capture file back in place of QSerialPort: the whole file is loaded by
+open(), then chunks are released at their recorded offsets divided by speed
+(1 - real time, 10, 100 ...) and announced with readyRead(), exactly as the
+serial port does. Speed 0 releases up to MAX_BURST_BYTES per event loop pass,
+as fast as the reader takes them.
+replayFinished() is emitted once the last chunk has been read.
+*/
+class CaptureReplay : public QIODevice {
+    Q_OBJECT
+public:
+    // Released at once with speed 0 (one read burst)
+    static const int MAX_BURST_BYTES = 4096;
+
+    explicit CaptureReplay(const QString &fileName, double speed = 1.0, QObject *parent = nullptr);
+
+    // "1", "10", "100x", "max" (0); ok = false for anything else
+    static double speedFromString(const QString &text, bool *ok = nullptr);
+
+    // Load the file and start the clock (read-only); false and errorString() on failure
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+    QString fileName() const { return m_fileName; }
+    int chunkCount() const { return static_cast<int>(m_chunks.size()); }
+    qint64 totalBytes() const { return static_cast<qint64>(m_bytes.size()); }
+
+signals:
+    void replayFinished();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct Chunk {
+        qint64 offsetUs; // Since the first chunk of the capture
+        size_t end;      // End of the chunk in m_bytes (chunks are stored back to back)
+    };
+
+    QString m_fileName;
+    double m_speed;
+    std::vector<uint8_t> m_bytes;
+    std::vector<Chunk> m_chunks;
+    size_t m_nextChunk = 0;    // First chunk not released yet
+    size_t m_readPosition = 0; // Next byte for readData()
+    size_t m_released = 0;     // End of the released bytes
+    bool m_finished = false;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+
+    bool load();
+    // Release the chunks that are due, announce them and schedule the next ones
+    void release();
+    void schedule();
+};
+
+/*
+Records datagrams instead of sending them (replay output).
+Text is kept per destination, "address:port <datagram in hex>" per line, and
+destinations are written in the order of their first datagram, so the result
+does not depend on how frames were split into batches and can be compared
+byte for byte with a golden file.
+*/
+class DatagramCapture : public DatagramSink {
+public:
+    void write(const char *data, int size, const QHostAddress &address, quint16 port) override;
+
+    uint64_t datagrams() const { return m_datagrams; }
+    uint64_t bytes() const { return m_bytes; }
+    QByteArray text() const;
+    bool save(const QString &fileName) const;
+    /*
+    Compare text() with the file
+    Return: 0 if equal, otherwise the first line (1-based) that differs; -1 if the file cannot be read
+    */
+    int compare(const QString &goldenFile) const;
+
+private:
+    struct Stream {
+        QHostAddress address;
+        quint16 port;
+        QByteArray prefix; // "address:port "
+        QByteArray text;
+    };
+    QVector<Stream> m_streams;
+    uint64_t m_datagrams = 0;
+    uint64_t m_bytes = 0;
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,96 @@
+#include "framequeue.h"
+#include <QThread>
+
+QueuePolicy queuePolicyFromString(const QString &name, bool *ok) {
+    if (ok) {
+        *ok = true;
+    }
+    if (name.compare("dropOldest", Qt::CaseInsensitive) == 0) return QueuePolicy::DropOldest;
+    if (name.compare("dropNewest", Qt::CaseInsensitive) == 0) return QueuePolicy::DropNewest;
+    if (name.compare("block", Qt::CaseInsensitive) == 0) return QueuePolicy::Block;
+    if (ok) {
+        *ok = false;
+    }
+    return QueuePolicy::DropOldest;
+}
+
+FrameQueue::FrameQueue(int capacity, QueuePolicy policy) : m_policy(policy) {
+    uint32_t size = 2;
+    while (size < static_cast<uint32_t>(capacity)) {
+        size <<= 1;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+}
+
+bool FrameQueue::push(const uint8_t *frame, int size, int64_t receivedNs) {
+    if (size > SCI_MAX_FRAME_SIZE) {
+        size = SCI_MAX_FRAME_SIZE;
+    }
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+
+    if (tail - head > m_mask) {
+        switch (m_policy.load(std::memory_order_relaxed)) {
+        case QueuePolicy::DropNewest:
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        case QueuePolicy::DropOldest:
+            // Consumer may pop the same frame right now: whoever wins the CAS moves head
+            if (m_head.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        case QueuePolicy::Block:
+            m_blocked.fetch_add(1, std::memory_order_relaxed);
+            while (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+                if (m_interrupted.load(std::memory_order_acquire)) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                QThread::usleep(BLOCK_SLEEP_US);
+            }
+            break;
+        }
+    }
+
+    SciFrame &slot = m_slots[tail & m_mask];
+    slot.size = static_cast<uint8_t>(size);
+    slot.receivedNs = receivedNs;
+    for (int i = 0; i < size; ++i) {
+        slot.bytes[i] = frame[i];
+    }
+    m_tail.store(tail + 1, std::memory_order_release);
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+
+    int depth = static_cast<int>(tail + 1 - m_head.load(std::memory_order_relaxed));
+    if (depth > m_highWater.load(std::memory_order_relaxed)) {
+        m_highWater.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool FrameQueue::pop(SciFrame &frame) {
+    uint32_t head = m_head.load(std::memory_order_acquire);
+    for (;;) {
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        const SciFrame &slot = m_slots[head & m_mask];
+        frame.size = slot.size;
+        frame.receivedNs = slot.receivedNs;
+        for (int i = 0; i < slot.size && i < SCI_MAX_FRAME_SIZE; ++i) {
+            frame.bytes[i] = slot.bytes[i];
+        }
+        // If the producer dropped this frame meanwhile the copy may be torn: retry with the new head
+        if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+int FrameQueue::depth() const {
+    uint32_t head = m_head.load(std::memory_order_acquire);
+    uint32_t tail = m_tail.load(std::memory_order_acquire);
+    return static_cast<int>(tail - head);
+}
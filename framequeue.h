@@ -0,0 +1,106 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <QString>
+#include "sciprotocol.h"
+
+// One complete SCI frame (STX ... ETX) stored by value
+struct SciFrame {
+    uint8_t size = 0;
+    uint8_t bytes[SCI_MAX_FRAME_SIZE];
+    int64_t receivedNs = 0; // Metrics::now() of the read that completed the frame
+};
+
+/*
+What the producer does when the queue is full:
+>DropOldest - overwrite the oldest queued frame (fresh state is worth more than old)
+>DropNewest - discard the frame being pushed
+>Block - wait until the consumer frees a slot (the serial driver buffers meanwhile)
+*/
+enum class QueuePolicy {
+    DropOldest,
+    DropNewest,
+    Block
+};
+
+// "dropOldest" / "dropNewest" / "block", ok = false for anything else
+QueuePolicy queuePolicyFromString(const QString &name, bool *ok = nullptr);
+
+/*
+Bounded lock-free single-producer/single-consumer ring of SCI frames.
+Producer is the serial I/O thread (PortListener), consumer is the conversion
+thread (SnmpConverter). Slots are allocated once in the constructor, push()
+and pop() copy at most SCI_MAX_FRAME_SIZE bytes and never allocate or lock.
+With DropOldest the producer may advance the read index too, so both sides
+move it with compare-and-swap; the consumer discards a copy if it lost the race.
+*/
+class FrameQueue {
+public:
+    static const int DEFAULT_CAPACITY = 256;
+
+    // Capacity is rounded up to a power of two
+    explicit FrameQueue(int capacity = DEFAULT_CAPACITY, QueuePolicy policy = QueuePolicy::DropOldest);
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue &operator=(const FrameQueue&) = delete;
+
+    /*
+    Producer side: copy one frame into the queue
+    Return: false if the frame was dropped (DropNewest, or Block interrupted)
+    */
+    bool push(const uint8_t *frame, int size, int64_t receivedNs = 0);
+    /*
+    Consumer side: take the oldest frame
+    Return: false if the queue is empty
+    */
+    bool pop(SciFrame &frame);
+
+    /*
+    Producer side, after push(): true if the consumer has to be woken up,
+    i.e. no wake-up is already pending. Keeps one queued event per burst instead of one per frame
+    */
+    bool requestNotify() { return !m_notifyPending.exchange(true, std::memory_order_acq_rel); }
+    // Consumer side, before draining: frames pushed after this call trigger a new wake-up
+    void clearNotify() { m_notifyPending.store(false, std::memory_order_release); }
+    // Stop waiting in push() with Block policy (shutdown)
+    void interrupt() { m_interrupted.store(true, std::memory_order_release); }
+
+    void setPolicy(QueuePolicy policy) { m_policy.store(policy, std::memory_order_relaxed); }
+    QueuePolicy policy() const { return m_policy.load(std::memory_order_relaxed); }
+    int capacity() const { return m_mask + 1; }
+
+    // Frames currently queued
+    int depth() const;
+    // Largest depth seen
+    int highWater() const { return m_highWater.load(std::memory_order_relaxed); }
+    // Frames accepted by push()
+    uint64_t pushed() const { return m_pushed.load(std::memory_order_relaxed); }
+    // Frames lost to the policy (oldest overwritten or newest discarded)
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    // Number of times push() had to wait with Block policy
+    uint64_t blocked() const { return m_blocked.load(std::memory_order_relaxed); }
+
+private:
+    // Sleep between checks while blocked
+    static const int BLOCK_SLEEP_US = 200;
+
+    std::vector<SciFrame> m_slots;
+    uint32_t m_mask;
+    std::atomic<QueuePolicy> m_policy;
+
+    // Indexes grow monotonically, slot = index & m_mask; separate cache lines for producer and consumer
+    alignas(64) std::atomic<uint32_t> m_head{0}; // Next frame to pop
+    alignas(64) std::atomic<uint32_t> m_tail{0}; // Next free slot
+
+    alignas(64) std::atomic<bool> m_notifyPending{false};
+    std::atomic<bool> m_interrupted{false};
+    std::atomic<int> m_highWater{0};
+    std::atomic<uint64_t> m_pushed{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_blocked{0};
+};
+
+#endif // FRAMEQUEUE_H
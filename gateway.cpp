@@ -0,0 +1,182 @@
+#include "gateway.h"
+#include "snmpconverter.h"
+#include <QThread>
+#include <QDebug>
+
+Gateway::Gateway(SnmpConverter *converter, int ioThreads, QObject *parent)
+    : QObject(parent), m_converter(converter), m_statsTimer(this) {
+    if (ioThreads < 1) {
+        ioThreads = 1;
+    }
+    for (int i = 0; i < ioThreads; ++i) {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("SerialIO-%1").arg(i));
+        m_threads.append(thread);
+    }
+    connect(&m_statsTimer, &QTimer::timeout, this, &Gateway::logStats);
+    setStatsInterval(DEFAULT_STATS_INTERVAL_MS);
+}
+
+Gateway::~Gateway() {
+    stop();
+}
+
+void Gateway::addPort(const PortConfig &config) {
+    Port port;
+    if (config.replayFile.isEmpty()) {
+        port.listener = new PortListener(config.serial); // Throws on invalid settings
+    } else {
+        port.listener = new PortListener(config.replayFile, config.replaySpeed);
+        ++m_replaysRunning;
+        connect(port.listener, &PortListener::replayFinished, this, [this]() {
+            if (--m_replaysRunning == 0) {
+                emit replayFinished();
+            }
+        });
+    }
+    port.name = port.listener->name();
+    port.listener->setCaptureFile(config.captureFile);
+    port.listener->setPollConfig(config.poll);
+    port.queue = new FrameQueue(config.queueCapacity, config.queuePolicy);
+    port.source = m_converter->addFrameSource(port.queue, config.listenAddress);
+    port.lastFrames = 0;
+
+    port.listener->setFrameQueue(port.queue);
+    if (PollScheduler *poller = port.listener->poller()) {
+        connect(poller, &PollScheduler::commandFinished, this, &Gateway::commandFinished, Qt::QueuedConnection);
+    }
+    connect(port.listener, &PortListener::framesAvailable, m_converter, &SnmpConverter::processQueuedFrames, Qt::QueuedConnection);
+    connect(port.listener, &PortListener::errorOccurred, this, [name = port.name](const QString &err) {
+        qWarning() << "Port Error:" << name << err;
+    });
+
+    // Round-robin over the I/O threads
+    QThread *thread = m_threads[m_ports.size() % m_threads.size()];
+    port.listener->moveToThread(thread);
+    connect(thread, &QThread::started, port.listener, &PortListener::connectPort);
+
+    qDebug() << "Port" << port.name << "listen address" << config.listenAddress
+             << "queue" << port.queue->capacity() << "on" << thread->objectName();
+    m_ports.append(port);
+}
+
+void Gateway::setStatsInterval(int intervalMs) {
+    if (intervalMs > 0) {
+        m_statsTimer.start(intervalMs);
+    } else {
+        m_statsTimer.stop();
+    }
+}
+
+bool Gateway::submitCommand(uint8_t address, int control, int32_t value, uint64_t token) {
+    for (Port &port : m_ports) {
+        PollScheduler *poller = port.listener->poller();
+        if (poller && poller->servesUnit(address)) {
+            return poller->submitCommand(address, control, value, token);
+        }
+    }
+    return false;
+}
+
+void Gateway::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    // Threads without ports would only idle
+    int used = m_ports.size() < m_threads.size() ? m_ports.size() : m_threads.size();
+    for (int i = 0; i < used; ++i) {
+        m_threads[i]->start(QThread::TimeCriticalPriority);
+    }
+    qDebug() << "Gateway started:" << m_ports.size() << "ports on" << used << "I/O threads";
+}
+
+void Gateway::stop() {
+    if (m_ports.isEmpty()) {
+        return;
+    }
+    for (Port &port : m_ports) {
+        port.queue->interrupt(); // Release producers blocked on a full queue
+    }
+    for (Port &port : m_ports) {
+        // Port timers and notifiers can only be stopped by the I/O thread that owns them
+        if (port.listener->thread()->isRunning()) {
+            QMetaObject::invokeMethod(port.listener, "disconnectPort", Qt::BlockingQueuedConnection);
+        }
+    }
+    for (QThread *thread : m_threads) {
+        thread->quit();
+        thread->wait();
+    }
+    m_running = false;
+    m_converter->processQueuedFrames(); // Frames read before the stop
+    m_converter->flushPending();        // Do not wait for the coalescing window
+    logStats();
+
+    // Threads are finished, listeners that ran are back in this thread: destroy them, then their queues
+    m_converter->clearFrameSources();
+    for (Port &port : m_ports) {
+        delete port.listener;
+        delete port.queue;
+    }
+    m_ports.clear();
+}
+
+void Gateway::logStats() {
+    for (Port &port : m_ports) {
+        uint64_t frames = port.listener->framesRead();
+        qDebug() << "Port" << port.name << "bytes:" << port.listener->bytesRead()
+                 << "frames:" << frames << "(+" << frames - port.lastFrames << ")"
+                 << "converted:" << m_converter->framesConverted(port.source)
+                 << "discarded bytes:" << port.listener->discardedBytes()
+                 << "bad CRC:" << port.listener->crcErrors()
+                 << "queue depth:" << port.queue->depth() << "high water:" << port.queue->highWater()
+                 << "dropped:" << port.queue->dropped() << "blocked:" << port.queue->blocked();
+        port.lastFrames = frames;
+        if (const PollScheduler *poller = port.listener->poller()) {
+            for (int i = 0; i < poller->unitCount(); ++i) {
+                qDebug() << "Poll" << port.name << "unit" << QString::number(poller->unitAddress(i), 16).toUpper()
+                         << (poller->isOffline(i) ? "offline" : "online") << "queries:" << poller->queries(i)
+                         << "replies:" << poller->replies(i) << "retries:" << poller->retries(i)
+                         << "timeouts:" << poller->timeouts(i) << "NACK:" << poller->nacks(i)
+                         << "round trip (us):" << poller->roundTrip(i).summary();
+            }
+            qDebug() << "Poll" << port.name << "cycle (us):" << poller->cycleTime().summary()
+                     << "write errors:" << poller->writeErrors();
+            qDebug() << "Control" << port.name << "commands:" << poller->commands()
+                     << "coalesced:" << poller->commandsCoalesced() << "ACK:" << poller->commandsAcked()
+                     << "NACK:" << poller->commandsNacked() << "failed:" << poller->commandsFailed();
+        }
+    }
+    qDebug() << "Rejected SCI frames - too short:" << m_converter->sciErrors(SciStatus::TooShort)
+             << "STX/ETX:" << m_converter->sciErrors(SciStatus::BadDelimiters)
+             << "length:" << m_converter->sciErrors(SciStatus::BadLength)
+             << "CRC:" << m_converter->sciErrors(SciStatus::BadCrc);
+    qDebug() << "SNMP updates sent:" << m_converter->filter().passed()
+             << "suppressed:" << m_converter->filter().suppressed()
+             << "too large:" << m_converter->oversizedVarbinds();
+    qDebug() << "Route cache - hits:" << m_converter->routeCache()->hits()
+             << "refreshes:" << m_converter->routeCache()->refreshes();
+    qDebug() << "SNMP messages - per frame:" << m_converter->flushes(FLUSH_FRAME)
+             << "window:" << m_converter->flushes(FLUSH_WINDOW) << "size:" << m_converter->flushes(FLUSH_SIZE)
+             << "alarm:" << m_converter->flushes(FLUSH_ALARM);
+    for (int i = 0; i < m_converter->destinationCount(); ++i) {
+        const DestinationConfig &destination = m_converter->destination(i);
+        const UdpSender *sender = m_converter->sender(i);
+        qDebug() << "Destination" << destination.address.toString() << ":" << destination.port
+                 << "datagrams:" << sender->datagrams() << "syscalls:" << sender->syscalls()
+                 << "per syscall:" << sender->datagramsPerSyscall() << "pending:" << sender->pending()
+                 << "dropped:" << sender->dropped() << "errors:" << sender->errors();
+    }
+    if (const StateFile *state = m_converter->stateFile()) {
+        qDebug() << "State file" << state->fileName() << "objects:" << state->size()
+                 << "writes:" << state->writes() << "dropped:" << state->dropped();
+    }
+    qDebug() << "SNMP flush latency (us):" << m_converter->flushLatency().summary();
+    qDebug() << "SNMP batch size (varbinds):" << m_converter->batchSize().summary();
+    if (const SnmpNotifier *notifier = m_converter->notifier()) {
+        qDebug() << "SNMP notifications - alarm changes:" << notifier->events() << "sent:" << notifier->sent()
+                 << "rate limited:" << notifier->rateLimited() << "informs acked:" << notifier->informsAcked()
+                 << "retransmitted:" << notifier->informsRetransmitted() << "failed:" << notifier->informsFailed();
+    }
+}
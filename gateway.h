@@ -0,0 +1,94 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+#include "portlistener.h"
+#include "framequeue.h"
+#include "scicontrol.h"
+
+class QThread;
+class SnmpConverter;
+
+/*
+Settings of one RS485 bus (one [SerialPort] section of config.ini)
+>serial - QSerialPort settings
+>listenAddress - unit filter of this bus: -1 for all, otherwise specific address
+>queuePolicy, queueCapacity - frame queue between the I/O thread and the converter
+>replayFile, replaySpeed - read a capture instead of the port (see CaptureReplay)
+>captureFile - record everything read from the port
+>poll - bus master: query the units instead of waiting for them (not with replayFile)
+*/
+struct PortConfig {
+    portSettings serial;
+    int listenAddress = -1;
+    QueuePolicy queuePolicy = QueuePolicy::DropOldest;
+    int queueCapacity = FrameQueue::DEFAULT_CAPACITY;
+    QString replayFile;
+    double replaySpeed = 1.0;
+    QString captureFile;
+    PollConfig poll;
+};
+
+/*
+Serves several RS485 buses in one process.
+Every port gets its own PortListener and FrameQueue; listeners are spread
+round-robin over a fixed pool of I/O threads, so threads and event loops do
+not grow with the number of buses. All queues are drained by one
+SnmpConverter (one PDU builder, one UDP socket, one route cache) in the
+thread that owns it.
+Control commands (SNMP SET) go to the bus master of the port that polls the unit.
+*/
+class Gateway : public QObject, public SciCommandTarget {
+    Q_OBJECT
+public:
+    static const int DEFAULT_STATS_INTERVAL_MS = 60000;
+
+    explicit Gateway(SnmpConverter *converter, int ioThreads = 1, QObject *parent = nullptr);
+    ~Gateway();
+
+    /*
+    Create listener and queue for the bus, before start()
+    Throws std::invalid_argument if the serial settings are rejected
+    */
+    void addPort(const PortConfig &config);
+    int portCount() const { return m_ports.size(); }
+    int ioThreadCount() const { return m_threads.size(); }
+    // Period of the per-port statistics log, 0 disables it
+    void setStatsInterval(int intervalMs);
+    // Queue the command on the first port with poll=true that polls the unit
+    bool submitCommand(uint8_t address, int control, int32_t value, uint64_t token) override;
+
+public slots:
+    // Start I/O threads, every listener opens its port in its own thread
+    void start();
+    // Stop I/O threads and release listeners and queues
+    void stop();
+    // Log per-port counters (and deltas since the previous call)
+    void logStats();
+
+signals:
+    // Every replayed port has read its whole capture (frames may still be queued)
+    void replayFinished();
+    // Result of submitCommand(token), a SciControlResult
+    void commandFinished(quint64 token, int result);
+
+private:
+    struct Port {
+        QString name;
+        PortListener *listener;
+        FrameQueue *queue;
+        int source;          // Index in SnmpConverter::addFrameSource()
+        uint64_t lastFrames; // framesRead() at the previous logStats()
+    };
+
+    SnmpConverter *m_converter;
+    QVector<QThread*> m_threads;
+    QVector<Port> m_ports;
+    QTimer m_statsTimer;
+    bool m_running = false;
+    int m_replaysRunning = 0; // Replayed ports that have not finished yet
+};
+
+#endif // GATEWAY_H
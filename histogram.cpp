@@ -0,0 +1,48 @@
+#include "histogram.h"
+
+void Histogram::reset() {
+    for (std::atomic<uint64_t> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    int shift = (index - SUB_BUCKETS) / SUB_BUCKETS; // exponent - SUB_BUCKET_BITS
+    uint64_t sub = static_cast<uint64_t>((index - SUB_BUCKETS) % SUB_BUCKETS);
+    // Bucket covers [(16 + sub) << shift, (17 + sub) << shift)
+    uint64_t first = (SUB_BUCKETS + sub) << shift;
+    return first + ((uint64_t(1) << shift) - 1);
+}
+
+uint64_t Histogram::percentile(double percent) const {
+    uint64_t total = count();
+    uint64_t max = this->max();
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the sample, 1-based
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+QString Histogram::summary() const {
+    return QString("count %1 mean %2 p50 %3 p90 %4 p99 %5 max %6")
+        .arg(count()).arg(mean(), 0, 'f', 1).arg(percentile(50)).arg(percentile(90)).arg(percentile(99)).arg(max());
+}
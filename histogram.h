@@ -0,0 +1,62 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <QString>
+
+/*
+Fixed-size histogram of non-negative integer samples (latencies, batch sizes).
+HDR-style log-linear buckets: values below 16 exactly, above that 16 buckets
+per power of two, so every recorded value is known within 1/16 (6.25%) from
+0 to 2^64. Recording is a few arithmetic operations and relaxed atomic
+increments on a member array, no allocation and no lock: any thread may
+record, readers see a consistent enough snapshot for statistics.
+*/
+class Histogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    void record(uint64_t value) {
+        m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+    void reset();
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+    double mean() const {
+        uint64_t n = count();
+        return n ? static_cast<double>(sum()) / n : 0.0;
+    }
+    // Upper bound of the bucket holding the given percentile (0..100), 0 when empty
+    uint64_t percentile(double percent) const;
+    // "count N mean M p50 A p90 B p99 C max D"
+    QString summary() const;
+
+    static int bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value); // >= SUB_BUCKET_BITS
+        int sub = static_cast<int>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+    }
+    // Largest value that falls into the bucket
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,385 @@
+#include "log.h"
+#include <QDateTime>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+std::atomic<int> Log::s_levels[LOG_CATEGORY_COUNT] = {
+    {LOG_LEVEL_DEBUG}, {LOG_LEVEL_DEBUG}, {LOG_LEVEL_DEBUG}, {LOG_LEVEL_DEBUG}, {LOG_LEVEL_DEBUG}
+};
+std::atomic<uint64_t> Log::s_dropped{0};
+
+namespace {
+
+// Pause of the log thread when the ring is empty
+const int IDLE_SLEEP_MS = 2;
+// One formatted line: hex blobs take three characters per byte
+const int LINE_SIZE = 64 + 3 * LogRecord::DATA_SIZE;
+
+// The ring is allocated once and kept until exit: producers may still hold a slot after stop()
+LogRecord *g_ring = nullptr;
+uint32_t g_mask = 0;
+alignas(64) std::atomic<uint32_t> g_enqueuePos{0};
+alignas(64) uint32_t g_dequeuePos = 0; // Log thread only
+std::atomic<bool> g_running{false};
+std::thread g_thread;
+
+// Record of the calling thread when messages are written synchronously
+thread_local LogRecord t_syncRecord;
+
+const char LEVEL_LETTERS[] = {'T', 'D', 'I', 'W', 'E'};
+const char *const CATEGORY_NAMES[LOG_CATEGORY_COUNT] = {"core", "serial", "sci", "snmp", "net"};
+
+// Bounded append to the output line
+struct LineWriter {
+    char *buffer;
+    int capacity;
+    int length = 0;
+
+    void put(char c) {
+        if (length < capacity) buffer[length++] = c;
+    }
+    void put(const char *text, int size) {
+        for (int i = 0; i < size; ++i) put(text[i]);
+    }
+    void put(const char *text) {
+        while (*text) put(*text++);
+    }
+};
+
+void formatArg(LineWriter &out, const LogRecord &record, const LogArg &arg) {
+    static const char HEX[] = "0123456789abcdef";
+    char number[32];
+    switch (arg.type) {
+    case LogArg::Int:
+        out.put(number, snprintf(number, sizeof(number), "%lld", static_cast<long long>(arg.i)));
+        break;
+    case LogArg::UInt:
+        out.put(number, snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(arg.u)));
+        break;
+    case LogArg::Double:
+        out.put(number, snprintf(number, sizeof(number), "%g", arg.d));
+        break;
+    case LogArg::Text:
+        out.put(record.data + arg.offset, arg.length);
+        break;
+    case LogArg::Hex:
+        for (int i = 0; i < arg.length; ++i) {
+            uint8_t byte = static_cast<uint8_t>(record.data[arg.offset + i]);
+            if (i > 0) out.put(' ');
+            out.put(HEX[byte >> 4]);
+            out.put(HEX[byte & 0x0F]);
+        }
+        if (arg.total > arg.length) {
+            out.put(number, snprintf(number, sizeof(number), " ...(+%u bytes)", static_cast<unsigned>(arg.total - arg.length)));
+        }
+        break;
+    }
+}
+
+// "hh:mm:ss.zzz L category: message\n"
+int formatRecord(const LogRecord &record, char *line, int capacity) {
+    LineWriter out{line, capacity - 1};
+    static const int utcOffsetSec = QDateTime::currentDateTime().offsetFromUtc();
+    int64_t local = record.timestamp / 1000 + utcOffsetSec;
+    int secondOfDay = static_cast<int>(((local % 86400) + 86400) % 86400);
+    char prefix[48];
+    out.put(prefix, snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %c %s: ",
+                             secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60,
+                             static_cast<int>(record.timestamp % 1000),
+                             LEVEL_LETTERS[record.level < 5 ? record.level : 4], CATEGORY_NAMES[record.category]));
+
+    if (!record.format) {
+        out.put(record.data, record.dataLength);
+    } else {
+        int argIndex = 0;
+        for (const char *p = record.format; *p; ++p) {
+            if (p[0] == '{' && p[1] == '}') {
+                if (argIndex < record.argCount) {
+                    formatArg(out, record, record.args[argIndex++]);
+                } else {
+                    out.put("{}");
+                }
+                ++p;
+            } else {
+                out.put(*p);
+            }
+        }
+    }
+    out.buffer[out.length++] = '\n';
+    return out.length;
+}
+
+void writeRecord(const LogRecord &record) {
+    char line[LINE_SIZE];
+    int length = formatRecord(record, line, sizeof(line));
+    fwrite(line, 1, length, stderr);
+}
+
+void logThread() {
+    uint64_t reportedDrops = 0;
+    for (;;) {
+        bool running = g_running.load(std::memory_order_acquire);
+        int written = 0;
+        for (;;) {
+            LogRecord &record = g_ring[g_dequeuePos & g_mask];
+            if (record.sequence.load(std::memory_order_acquire) != g_dequeuePos + 1) {
+                break; // Empty or the producer has not published yet
+            }
+            writeRecord(record);
+            // Free the slot for the producer one lap ahead
+            record.sequence.store(g_dequeuePos + g_mask + 1, std::memory_order_release);
+            ++g_dequeuePos;
+            ++written;
+        }
+        uint64_t drops = Log::dropped();
+        if (drops != reportedDrops) {
+            fprintf(stderr, "Log queue full, %llu messages dropped (total %llu)\n",
+                    static_cast<unsigned long long>(drops - reportedDrops), static_cast<unsigned long long>(drops));
+            reportedDrops = drops;
+            ++written;
+        }
+        if (written > 0) {
+            fflush(stderr);
+        }
+        if (!running) {
+            return;
+        }
+        if (written == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_SLEEP_MS));
+        }
+    }
+}
+
+void qtMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &message) {
+    int level = LOG_LEVEL_DEBUG;
+    switch (type) {
+    case QtDebugMsg: level = LOG_LEVEL_DEBUG; break;
+    case QtInfoMsg: level = LOG_LEVEL_INFO; break;
+    case QtWarningMsg: level = LOG_LEVEL_WARNING; break;
+    default: level = LOG_LEVEL_ERROR; break;
+    }
+    if (Log::enabled(LOG_CORE, level) || type == QtFatalMsg) {
+        QByteArray text = message.toUtf8();
+        Log::writeText(LOG_CORE, level, text.constData(), text.size());
+    }
+    if (type == QtFatalMsg) {
+        Log::stop();
+        abort();
+    }
+}
+
+} // namespace
+
+LogArg *LogRecord::nextArg(LogArg::Type type) {
+    if (argCount == MAX_ARGS) {
+        return nullptr;
+    }
+    LogArg *arg = &args[argCount++];
+    arg->type = type;
+    arg->offset = 0;
+    arg->length = 0;
+    arg->total = 0;
+    return arg;
+}
+
+void LogRecord::addText(const char *text, int length) {
+    LogArg *arg = nextArg(LogArg::Text);
+    if (!arg) {
+        return;
+    }
+    int space = DATA_SIZE - dataLength;
+    if (length > space) {
+        length = space;
+    }
+    arg->offset = dataLength;
+    arg->length = static_cast<uint16_t>(length);
+    for (int i = 0; i < length; ++i) {
+        data[dataLength++] = text[i];
+    }
+}
+
+void LogRecord::add(const char *text) {
+    int length = 0;
+    while (text && text[length]) {
+        ++length;
+    }
+    addText(text, length);
+}
+
+void LogRecord::add(const QString &text) {
+    LogArg *arg = nextArg(LogArg::Text);
+    if (!arg) {
+        return;
+    }
+    // UTF-16 -> UTF-8 straight into the record, no temporary QByteArray
+    arg->offset = dataLength;
+    const QChar *chars = text.constData();
+    int size = text.size();
+    for (int i = 0; i < size; ++i) {
+        uint32_t c = chars[i].unicode();
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < size) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (chars[++i].unicode() - 0xDC00);
+        }
+        char utf8[4];
+        int n;
+        if (c < 0x80) { utf8[0] = static_cast<char>(c); n = 1; }
+        else if (c < 0x800) { utf8[0] = static_cast<char>(0xC0 | (c >> 6)); utf8[1] = static_cast<char>(0x80 | (c & 0x3F)); n = 2; }
+        else if (c < 0x10000) { utf8[0] = static_cast<char>(0xE0 | (c >> 12)); utf8[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F)); utf8[2] = static_cast<char>(0x80 | (c & 0x3F)); n = 3; }
+        else { utf8[0] = static_cast<char>(0xF0 | (c >> 18)); utf8[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F)); utf8[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F)); utf8[3] = static_cast<char>(0x80 | (c & 0x3F)); n = 4; }
+        if (dataLength + n > DATA_SIZE) {
+            break;
+        }
+        for (int k = 0; k < n; ++k) {
+            data[dataLength++] = utf8[k];
+        }
+    }
+    arg->length = static_cast<uint16_t>(dataLength - arg->offset);
+}
+
+void LogRecord::addHex(const void *bytes, int size) {
+    LogArg *arg = nextArg(LogArg::Hex);
+    if (!arg) {
+        return;
+    }
+    int length = size;
+    int space = DATA_SIZE - dataLength;
+    if (length > space) {
+        length = space;
+    }
+    arg->offset = dataLength;
+    arg->length = static_cast<uint16_t>(length);
+    arg->total = static_cast<uint32_t>(size);
+    const char *source = static_cast<const char*>(bytes);
+    for (int i = 0; i < length; ++i) {
+        data[dataLength++] = source[i];
+    }
+}
+
+void Log::start(int queueSize) {
+    if (g_running.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (!g_ring) {
+        uint32_t size = 2;
+        while (size < static_cast<uint32_t>(queueSize)) {
+            size <<= 1;
+        }
+        g_ring = new LogRecord[size];
+        for (uint32_t i = 0; i < size; ++i) {
+            g_ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        g_mask = size - 1;
+        g_enqueuePos.store(0, std::memory_order_relaxed);
+        g_dequeuePos = 0;
+    }
+    g_running.store(true, std::memory_order_release);
+    g_thread = std::thread(logThread);
+}
+
+void Log::stop() {
+    if (!g_running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    // The thread drains the ring once more before it exits
+    if (g_thread.joinable() && g_thread.get_id() != std::this_thread::get_id()) {
+        g_thread.join();
+    }
+}
+
+void Log::installQtMessageHandler() {
+    qInstallMessageHandler(qtMessageHandler);
+}
+
+void Log::setLevel(int level) {
+    for (int i = 0; i < LOG_CATEGORY_COUNT; ++i) {
+        s_levels[i].store(level, std::memory_order_relaxed);
+    }
+}
+
+void Log::setLevel(LogCategory category, int level) {
+    s_levels[category].store(level, std::memory_order_relaxed);
+}
+
+int Log::levelFromString(const QString &name, bool *ok) {
+    static const char *const NAMES[] = {"trace", "debug", "info", "warning", "error", "off"};
+    for (int i = 0; i <= LOG_LEVEL_OFF; ++i) {
+        if (name.compare(NAMES[i], Qt::CaseInsensitive) == 0) {
+            if (ok) *ok = true;
+            return i;
+        }
+    }
+    if (ok) *ok = false;
+    return LOG_LEVEL_DEBUG;
+}
+
+int Log::categoryFromString(const QString &name) {
+    for (int i = 0; i < LOG_CATEGORY_COUNT; ++i) {
+        if (name.compare(CATEGORY_NAMES[i], Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *Log::categoryName(LogCategory category) {
+    return CATEGORY_NAMES[category];
+}
+
+void Log::writeText(LogCategory category, int level, const char *text, int length) {
+    LogRecord *record = beginRecord(category, level, nullptr);
+    if (!record) {
+        return;
+    }
+    if (length > LogRecord::DATA_SIZE) {
+        length = LogRecord::DATA_SIZE;
+    }
+    for (int i = 0; i < length; ++i) {
+        record->data[i] = text[i];
+    }
+    record->dataLength = static_cast<uint16_t>(length);
+    commitRecord(record);
+}
+
+LogRecord *Log::beginRecord(LogCategory category, int level, const char *format) {
+    LogRecord *record = &t_syncRecord;
+    if (g_running.load(std::memory_order_acquire)) {
+        // Reserve a slot: its sequence equals the position when it is free for this lap
+        uint32_t position = g_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            LogRecord &slot = g_ring[position & g_mask];
+            int32_t difference = static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - position);
+            if (difference == 0) {
+                if (g_enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    record = &slot;
+                    record->position = position;
+                    break;
+                }
+            } else if (difference < 0) {
+                s_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr; // Full: the log thread has not freed this slot yet
+            } else {
+                position = g_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    record->timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record->format = format;
+    record->level = static_cast<uint8_t>(level);
+    record->category = static_cast<uint8_t>(category);
+    record->argCount = 0;
+    record->dataLength = 0;
+    return record;
+}
+
+void Log::commitRecord(LogRecord *record) {
+    if (record == &t_syncRecord) {
+        writeRecord(*record);
+        fflush(stderr);
+        return;
+    }
+    record->sequence.store(record->position + 1, std::memory_order_release);
+}
@@ -0,0 +1,166 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <QString>
+
+// Log levels
+#define LOG_LEVEL_TRACE   0
+#define LOG_LEVEL_DEBUG   1
+#define LOG_LEVEL_INFO    2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_ERROR   4
+#define LOG_LEVEL_OFF     5
+
+// Messages below this level are removed by the compiler (set in RS485_2.pro)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// Log categories, each has its own runtime level
+enum LogCategory {
+    LOG_CORE,   // Startup, configuration, qDebug()/qWarning() output
+    LOG_SERIAL, // Serial ports and frame reassembly
+    LOG_SCI,    // SCI decoding
+    LOG_SNMP,   // SNMP encoding and sending
+    LOG_NET,    // Routes and sockets
+    LOG_CATEGORY_COUNT
+};
+
+/*
+Usage: LOG_DEBUG(LOG_SCI, "Src {} Cmd {} Data {}", src, cmd, logHex(data, size));
+Arguments are evaluated only if the level is compiled in and enabled at runtime.
+{} placeholders are filled by the log thread, the caller only copies the
+arguments (numbers, strings, hex blobs) into a fixed-size record.
+*/
+#define LOG_AT(level, category, ...) \
+    do { \
+        if ((level) >= LOG_COMPILE_LEVEL && Log::enabled((category), (level))) { \
+            Log::write((category), (level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(category, ...)   LOG_AT(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...)   LOG_AT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...)    LOG_AT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) LOG_AT(LOG_LEVEL_WARNING, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...)   LOG_AT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+
+// Byte blob printed as hex by the log thread
+struct LogHex {
+    const void *data;
+    int size;
+};
+inline LogHex logHex(const void *data, int size) { return LogHex{data, size}; }
+
+// One deferred argument; text and hex contents are stored in LogRecord::data
+struct LogArg {
+    enum Type : uint8_t { Int, UInt, Double, Text, Hex };
+    Type type;
+    uint16_t offset; // Text/Hex: position in LogRecord::data
+    uint16_t length; // Text/Hex: stored bytes
+    uint32_t total;  // Hex: original size (more than length if truncated)
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+};
+
+// Fixed-size queue element, never allocated after Log::start()
+struct LogRecord {
+    static const int MAX_ARGS = 8;
+    static const int DATA_SIZE = 320;
+
+    std::atomic<uint32_t> sequence; // Queue slot state (see Log::beginRecord)
+    uint32_t position;
+    int64_t timestamp;    // ms since epoch
+    const char *format;   // String literal with {} placeholders, nullptr: data holds the whole text
+    uint8_t level;
+    uint8_t category;
+    uint8_t argCount;
+    uint16_t dataLength;
+    LogArg args[MAX_ARGS];
+    char data[DATA_SIZE];
+
+    void addText(const char *text, int length);
+    void addHex(const void *bytes, int size);
+    void add(const char *text);
+    void add(const QString &text);
+    void add(const LogHex &hex) { addHex(hex.data, hex.size); }
+    void add(bool value) { add(value ? "true" : "false"); }
+    void add(double value) {
+        if (LogArg *arg = nextArg(LogArg::Double)) arg->d = value;
+    }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type add(T value) {
+        if (std::is_signed<T>::value) {
+            if (LogArg *arg = nextArg(LogArg::Int)) arg->i = static_cast<int64_t>(value);
+        } else {
+            if (LogArg *arg = nextArg(LogArg::UInt)) arg->u = static_cast<uint64_t>(value);
+        }
+    }
+
+private:
+    LogArg *nextArg(LogArg::Type type);
+};
+
+/*
+Asynchronous log sink.
+Producers (any thread) reserve a record in a bounded lock-free MPMC ring
+(Vyukov's sequence-per-slot queue), copy the arguments and publish it; the
+log thread formats the records and writes them to stderr. When the ring is
+full the message is dropped and counted, producers never block or allocate.
+Before start() (and after stop()) messages are formatted and written
+synchronously by the calling thread.
+*/
+class Log {
+public:
+    static const int DEFAULT_QUEUE_SIZE = 1024;
+
+    // Allocate the ring (rounded up to a power of two) and start the log thread
+    static void start(int queueSize = DEFAULT_QUEUE_SIZE);
+    // Write what is queued and stop the log thread
+    static void stop();
+    // Route qDebug()/qWarning() through the sink (category LOG_CORE)
+    static void installQtMessageHandler();
+
+    static void setLevel(int level); // All categories
+    static void setLevel(LogCategory category, int level);
+    static bool enabled(LogCategory category, int level) {
+        return level >= s_levels[category].load(std::memory_order_relaxed);
+    }
+    // "trace", "debug", "info", "warning", "error", "off"
+    static int levelFromString(const QString &name, bool *ok = nullptr);
+    // "core", "serial", "sci", "snmp", "net"; -1 if unknown
+    static int categoryFromString(const QString &name);
+    static const char *categoryName(LogCategory category);
+
+    template<typename... Args>
+    static void write(LogCategory category, int level, const char *format, const Args &...args) {
+        LogRecord *record = beginRecord(category, level, format);
+        if (!record) {
+            return;
+        }
+        int unused[] = {0, (record->add(args), 0)...};
+        (void)unused;
+        commitRecord(record);
+    }
+    // Already formatted text (copied, truncated to LogRecord::DATA_SIZE)
+    static void writeText(LogCategory category, int level, const char *text, int length);
+
+    // Messages lost because the ring was full
+    static uint64_t dropped() { return s_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<int> s_levels[LOG_CATEGORY_COUNT];
+    static std::atomic<uint64_t> s_dropped;
+
+    // nullptr if the ring is full
+    static LogRecord *beginRecord(LogCategory category, int level, const char *format);
+    static void commitRecord(LogRecord *record);
+};
+
+#endif // LOG_H
@@ -1,34 +1,258 @@
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
 #include <QSettings>
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
 #include "portlistener.h"
 #include "snmpconverter.h"
+#include "gateway.h"
+#include "log.h"
+#include "snmpagent.h"
+#include "snmpnotifier.h"
+#include "metricsserver.h"
+#include "metrics.h"
+#include "capture.h"
 
-void configurateSettings(portSettings &port, QSettings &settings) {
-    port.name = settings.value("SerialPort/portName", "COM1").toString();
-    qDebug() << "Port name:" << port.name;
-    port.baudRate = static_cast<QSerialPort::BaudRate>(settings.value("SerialPort/baudRate", 19200).toInt());
-    port.dataBits = static_cast<QSerialPort::DataBits>(settings.value("SerialPort/dataBits", 8).toInt());
-    QString parityStr = settings.value("SerialPort/parity", "None").toString();
+// Настройки журнала: общий уровень, уровни категорий, размер очереди
+void configurateLog(QSettings &settings) {
+    settings.beginGroup("Log");
+    bool ok = true;
+    QString levelStr = settings.value("level", "debug").toString();
+    int level = Log::levelFromString(levelStr, &ok);
+    if (!ok) {
+        qWarning() << "Invalid log level" << levelStr << ", using default: debug";
+    }
+    Log::setLevel(level);
+    // serial=trace, snmp=info, ...
+    foreach (const QString &key, settings.childKeys()) {
+        int category = Log::categoryFromString(key);
+        if (category < 0) {
+            continue;
+        }
+        QString categoryLevelStr = settings.value(key).toString();
+        int categoryLevel = Log::levelFromString(categoryLevelStr, &ok);
+        if (!ok) {
+            qWarning() << "Invalid log level" << categoryLevelStr << "for category" << key;
+            continue;
+        }
+        Log::setLevel(static_cast<LogCategory>(category), categoryLevel);
+    }
+    int queueSize = settings.value("queueSize", Log::DEFAULT_QUEUE_SIZE).toInt();
+    settings.endGroup();
+
+    Log::start(queueSize);
+    Log::installQtMessageHandler();
+}
+
+// Фильтр обновлений: отправка только изменившихся значений, зоны нечувствительности
+void configurateFilter(UpdateFilter &filter, QSettings &settings) {
+    settings.beginGroup("Filter");
+    filter.setEnabled(settings.value("enabled", false).toBool());
+    filter.setRefreshInterval(settings.value("refreshSec", UpdateFilter::DEFAULT_REFRESH_INTERVAL_MS / 1000).toInt() * 1000);
+    FilterRule rule;
+    foreach (const QString &key, settings.childKeys()) {
+        if (key == "enabled" || key == "refreshSec") {
+            continue;
+        }
+        QString ruleStr = settings.value(key).toString();
+        if (!UpdateFilter::parseRule(ruleStr, rule)) {
+            qWarning() << "Invalid filter rule" << key << "=" << ruleStr;
+            continue;
+        }
+        int param = UpdateFilter::paramFromName(key);
+        if (key == "default") {
+            filter.setDefaultRule(rule);
+        } else if (param >= 0) {
+            filter.setRule(static_cast<UnitParam>(param), rule);
+        } else {
+            qWarning() << "Unknown filter parameter" << key;
+        }
+    }
+    settings.endGroup();
+    qDebug() << "Update filter" << (filter.isEnabled() ? "enabled" : "disabled");
+}
+
+// Уведомления (trap/inform) при изменении аварий
+void configurateNotifier(SnmpNotifier *notifier, QSettings &settings, const QHostAddress &defaultAddress) {
+    settings.beginGroup("Trap");
+    QHostAddress address;
+    if (!address.setAddress(settings.value("ipAddress", defaultAddress.toString()).toString())) {
+        qWarning() << "Invalid trap address, using" << defaultAddress.toString();
+        address = defaultAddress;
+    }
+    bool ok = true;
+    QString typeStr = settings.value("type", "v2c").toString();
+    NotifyType type = SnmpNotifier::typeFromString(typeStr, &ok);
+    if (!ok) {
+        qWarning() << "Invalid trap type" << typeStr << ", using default: v2c";
+    }
+    notifier->setTarget(address, settings.value("port", 162).toUInt(), settings.value("community", "public").toString(), type);
+    // agent-addr в SNMPv1 Trap-PDU, по умолчанию - первый IPv4 адрес хоста
+    QHostAddress agentAddress;
+    if (!agentAddress.setAddress(settings.value("agentAddress").toString())) {
+        agentAddress = RouteCache::findLocalAddress();
+    }
+    notifier->setAgentAddress(agentAddress);
+    notifier->setRateLimit(settings.value("ratePerSec", SnmpNotifier::DEFAULT_RATE).toInt(),
+                           settings.value("burst", SnmpNotifier::DEFAULT_BURST).toInt());
+    notifier->setInformRetry(settings.value("informTimeoutMs", SnmpNotifier::DEFAULT_INFORM_TIMEOUT_MS).toInt(),
+                             settings.value("informRetries", SnmpNotifier::DEFAULT_INFORM_RETRIES).toInt());
+    settings.endGroup();
+}
+
+// Получатель сообщений: [Destination.N] (или [SNMP] для одного получателя)
+bool configurateDestination(DestinationConfig &config, QSettings &settings, const QString &group) {
+    settings.beginGroup(group);
+    bool ok = config.address.setAddress(settings.value("ipAddress").toString());
+    if (!ok) {
+        qWarning() << "Invalid ipAddress in" << group << ", destination skipped";
+    }
+    config.port = settings.value("port", 161).toUInt();
+    config.community = settings.value("community", "public").toString();
+    QString versionStr = settings.value("version", "1").toString();
+    if (versionStr == "1" || versionStr == "v1") {
+        config.version = SNMP_VERSION_1;
+    } else if (versionStr == "2c" || versionStr == "v2c") {
+        config.version = SNMP_VERSION_2C;
+    } else {
+        qWarning() << "Invalid SNMP version" << versionStr << "in" << group << ", using default: 1";
+    }
+    config.ratePerSec = settings.value("ratePerSec", 0).toInt();
+    config.burst = settings.value("burst", config.burst).toInt();
+    config.queueSize = settings.value("queueSize", UdpSender::DEFAULT_CAPACITY).toInt();
+    settings.endGroup();
+    return ok;
+}
+
+// Разбор адреса RS485: "all" -> -1, иначе шестнадцатеричный адрес ("0xA" или "A")
+int parseListenAddress(const QString &listenAddressStr) {
+    if (listenAddressStr == "all") {
+        return -1;
+    }
+    bool ok;
+    QString cleanedAddress = listenAddressStr.startsWith("0x") ? listenAddressStr.mid(2) : listenAddressStr;
+    int listenAddress = cleanedAddress.toUInt(&ok, 16);
+    if (!ok) {
+        qWarning() << "Invalid RS485 listen address:" << listenAddressStr << ", using 'all'";
+        return -1;
+    }
+    return listenAddress;
+}
+
+// Опрос блоков (ведущий шины): адреса, тайм-ауты, расписание подкоманд
+void configuratePoll(PollConfig &config, QSettings &settings) {
+    settings.beginGroup("Poll");
+    // Список через запятую QSettings возвращает как QStringList
+    QStringList unitList = settings.value("units", "A,B,C").toStringList();
+    QVector<uint8_t> units;
+    foreach (const QString &unitStr, unitList) {
+        int address = parseListenAddress(unitStr.trimmed());
+        if (address >= 0) {
+            units.append(static_cast<uint8_t>(address & 0x0F));
+        }
+    }
+    if (!units.isEmpty()) {
+        config.units = units;
+    }
+    config.masterAddress = static_cast<uint8_t>(parseListenAddress(settings.value("masterAddress", "0").toString()) & 0x0F);
+    QString queryCmdStr = settings.value("queryCmd", "8").toString();
+    bool queryCmdOk = false;
+    uint queryCmd = (queryCmdStr.startsWith("0x") ? queryCmdStr.mid(2) : queryCmdStr).toUInt(&queryCmdOk, 16);
+    if (queryCmdOk && queryCmd <= 0x0F) {
+        config.queryCmd = static_cast<uint8_t>(queryCmd);
+    } else {
+        qWarning() << "Invalid poll queryCmd" << queryCmdStr << ", using default: 8";
+    }
+    QString controlCmdStr = settings.value("controlCmd", "1").toString();
+    bool controlCmdOk = false;
+    uint controlCmd = (controlCmdStr.startsWith("0x") ? controlCmdStr.mid(2) : controlCmdStr).toUInt(&controlCmdOk, 16);
+    if (controlCmdOk && controlCmd <= 0x0F) {
+        config.controlCmd = static_cast<uint8_t>(controlCmd);
+    } else {
+        qWarning() << "Invalid poll controlCmd" << controlCmdStr << ", using default: 1";
+    }
+    config.responseTimeoutMs = qMax(1, settings.value("responseTimeoutMs", config.responseTimeoutMs).toInt());
+    config.retries = qMax(0, settings.value("retries", config.retries).toInt());
+    config.turnaroundMs = qMax(0, settings.value("turnaroundMs", config.turnaroundMs).toInt());
+    config.offlineAfter = qMax(1, settings.value("offlineAfter", config.offlineAfter).toInt());
+    config.offlineRetryMs = qMax(1, settings.value("offlineRetrySec", config.offlineRetryMs / 1000).toInt()) * 1000;
+    if (settings.contains("schedule")) {
+        QString schedule = settings.value("schedule").toStringList().join(",");
+        if (!PollConfig::parseItems(schedule, config.items)) {
+            qWarning() << "Invalid poll schedule" << schedule << ", using default";
+        }
+    }
+    settings.endGroup();
+}
+
+// Чтение одной секции порта ([SerialPort], [SerialPort.1], ...)
+void configurateSettings(PortConfig &config, QSettings &settings, const QString &group, int defaultListenAddress) {
+    portSettings &port = config.serial;
+    settings.beginGroup(group);
+    port.name = settings.value("portName", "COM1").toString();
+    qDebug() << "Port name:" << port.name << "section:" << group;
+    port.baudRate = static_cast<QSerialPort::BaudRate>(settings.value("baudRate", 19200).toInt());
+    port.dataBits = static_cast<QSerialPort::DataBits>(settings.value("dataBits", 8).toInt());
+    QString parityStr = settings.value("parity", "None").toString();
     if (parityStr == "None") port.parityMode = QSerialPort::NoParity;
     else if (parityStr == "Even") port.parityMode = QSerialPort::EvenParity;
     else if (parityStr == "Odd") port.parityMode = QSerialPort::OddParity;
-    port.stopBits = static_cast<QSerialPort::StopBits>(settings.value("SerialPort/stopBits", 1).toInt());
-    QString flowControlStr = settings.value("SerialPort/flowControl", "None").toString();
+    port.stopBits = static_cast<QSerialPort::StopBits>(settings.value("stopBits", 1).toInt());
+    QString flowControlStr = settings.value("flowControl", "None").toString();
     if (flowControlStr == "None") port.flowControlMode = QSerialPort::NoFlowControl;
     else if (flowControlStr == "Hardware") port.flowControlMode = QSerialPort::HardwareControl;
     else if (flowControlStr == "Software") port.flowControlMode = QSerialPort::SoftwareControl;
+
+    // Адрес блока на этой шине, по умолчанию - из [RS485]
+    config.listenAddress = settings.contains("listenAddress")
+        ? parseListenAddress(settings.value("listenAddress").toString()) : defaultListenAddress;
+
+    // Очередь кадров между потоком порта и конвертером
+    bool policyOk = true;
+    QString policyStr = settings.value("queuePolicy", "dropOldest").toString();
+    config.queuePolicy = queuePolicyFromString(policyStr, &policyOk);
+    if (!policyOk) {
+        qWarning() << "Invalid queuePolicy" << policyStr << ", using default: dropOldest";
+    }
+    config.queueCapacity = settings.value("queueCapacity", FrameQueue::DEFAULT_CAPACITY).toInt();
+    if (config.queueCapacity < 2) {
+        qWarning() << "Invalid queueCapacity" << config.queueCapacity << ", using default:" << FrameQueue::DEFAULT_CAPACITY;
+        config.queueCapacity = FrameQueue::DEFAULT_CAPACITY;
+    }
+    // Запись всего принятого с порта для последующего воспроизведения
+    config.captureFile = settings.value("captureFile").toString();
+    // Ведущий шины: опрос по расписанию [Poll]; с listenAddress опрашивается только этот блок
+    config.poll.enabled = settings.value("poll", false).toBool();
+    if (config.listenAddress >= 0) {
+        config.poll.units = {static_cast<uint8_t>(config.listenAddress)};
+    }
+    settings.endGroup();
 }
 
 int main(int argc, char *argv[]) {
     QCoreApplication a(argc, argv);
 
+    // Параметры командной строки заменяют секцию [Replay]
+    QCommandLineParser parser;
+    parser.setApplicationDescription("RS485 (SCI) to SNMP converter");
+    parser.addHelpOption();
+    QCommandLineOption replayOption("replay", "Read a capture file instead of the serial ports.", "file");
+    QCommandLineOption speedOption("speed", "Replay speed: 1 (real time), 10, 100 ... or max.", "speed");
+    QCommandLineOption outputOption("output", "Write the SNMP datagrams to a file instead of sending them.", "file");
+    QCommandLineOption goldenOption("golden", "Compare the SNMP datagrams with a golden file (exit code 1 if they differ).", "file");
+    parser.addOption(replayOption);
+    parser.addOption(speedOption);
+    parser.addOption(outputOption);
+    parser.addOption(goldenOption);
+    parser.process(a);
+
     // Формируем путь к config.ini
     QString projectDir = QString(PROJECT_DIR);
     QString configPath = projectDir + "/config.ini";
     QSettings settings(configPath, QSettings::IniFormat);
+    configurateLog(settings);
 
     // Проверяем, существует ли файл
     QFileInfo fileInfo(configPath);
@@ -44,10 +268,6 @@ int main(int argc, char *argv[]) {
     qDebug() << "Keys in RS485 section:" << keys;
     settings.endGroup();
 
-    // Читаем настройки порта
-    portSettings port;
-    configurateSettings(port, settings);
-
     // Читаем настройки SNMP
     QHostAddress snmpIp;
     if (!snmpIp.setAddress(settings.value("SNMP/ipAddress", "127.0.0.1").toString())) {
@@ -55,6 +275,12 @@ int main(int argc, char *argv[]) {
         snmpIp = QHostAddress("127.0.0.1");
     }
     quint16 snmpPort = settings.value("SNMP/port", 161).toUInt();
+    // Максимальный размер SNMP-сообщения (все значения одного SCI-кадра идут одним пакетом)
+    int maxPduSize = settings.value("SNMP/maxPduSize", SnmpPduBuilder::DEFAULT_MAX_SIZE).toInt();
+    if (maxPduSize < 128) {
+        qWarning() << "Invalid SNMP maxPduSize" << maxPduSize << ", using default:" << SnmpPduBuilder::DEFAULT_MAX_SIZE;
+        maxPduSize = SnmpPduBuilder::DEFAULT_MAX_SIZE;
+    }
 
     // Читаем маску подсети
     QHostAddress subnetMask;
@@ -71,38 +297,219 @@ int main(int argc, char *argv[]) {
         gateway = QHostAddress("0.0.0.0");
     }
     qDebug() << "Gateway set to:" << gateway.toString();
+    // Окно объединения значений нескольких кадров в одно сообщение (мс), 0 - сообщение на каждый кадр
+    int coalesceWindowMs = settings.value("SNMP/coalesceWindowMs", 0).toInt();
+    int coalesceMaxVarbinds = settings.value("SNMP/coalesceMaxVarbinds", 0).toInt();
+    // Период обновления кэша маршрутов (секунды), 0 - только по изменению сети
+    int routeRefreshSec = settings.value("SNMP/routeRefreshSec", RouteCache::DEFAULT_REFRESH_INTERVAL_MS / 1000).toInt();
 
-    // Читаем listenAddress
+    // Читаем listenAddress (по умолчанию для всех портов)
     QString listenAddressStr = settings.value("RS485/listenAddress", "all").toString();
     qDebug() << "Raw listenAddress from config:" << listenAddressStr;
-    int listenAddress = -1;
-    if (listenAddressStr != "all") {
-        bool ok;
-        QString cleanedAddress = listenAddressStr.startsWith("0x") ? listenAddressStr.mid(2) : listenAddressStr;
-        qDebug() << "Cleaned address:" << cleanedAddress;
-        listenAddress = cleanedAddress.toUInt(&ok, 16);
-        if (!ok) {
-            qWarning() << "Invalid RS485 listen address:" << listenAddressStr << ", using 'all'";
-            listenAddress = -1;
+    int listenAddress = parseListenAddress(listenAddressStr);
+    qDebug() << "Listen address set to:" << listenAddress;
+
+    // Читаем настройки портов: [SerialPort], [SerialPort.1], [SerialPort.2] ...
+    QStringList portGroups;
+    foreach (const QString &group, settings.childGroups()) {
+        if (group == "SerialPort" || group.startsWith("SerialPort.")) {
+            portGroups.append(group);
         }
     }
-    qDebug() << "Listen address set to:" << listenAddress;
+    if (portGroups.isEmpty()) {
+        portGroups.append("SerialPort"); // Значения по умолчанию
+    }
+    // Воспроизведение записи вместо портов
+    QString replayFile = parser.isSet(replayOption) ? parser.value(replayOption) : settings.value("Replay/file").toString();
+    QString replaySpeedStr = parser.isSet(speedOption) ? parser.value(speedOption) : settings.value("Replay/speed", "1").toString();
+    bool replaySpeedOk = true;
+    double replaySpeed = CaptureReplay::speedFromString(replaySpeedStr, &replaySpeedOk);
+    if (!replaySpeedOk) {
+        qWarning() << "Invalid replay speed" << replaySpeedStr << ", using real time";
+    }
+    QString replayOutput = parser.isSet(outputOption) ? parser.value(outputOption) : settings.value("Replay/outputFile").toString();
+    QString replayGolden = parser.isSet(goldenOption) ? parser.value(goldenOption) : settings.value("Replay/goldenFile").toString();
+    bool replayQuit = settings.value("Replay/quitAtEnd", true).toBool();
 
-    // Создаём объекты
-    PortListener *m_port = new PortListener(port);
-    SnmpConverter *m_snmp = new SnmpConverter(snmpIp, snmpPort, subnetMask, gateway, listenAddress);
+    int ioThreads = settings.value("Gateway/ioThreads", 1).toInt();
+    int statsIntervalSec = settings.value("Gateway/statsIntervalSec", Gateway::DEFAULT_STATS_INTERVAL_MS / 1000).toInt();
 
-    // Соединяем сигналы и слоты
-    QObject::connect(m_port, &PortListener::readedInfo, m_snmp, &SnmpConverter::processSciDataSlot);
-    QObject::connect(m_port, &PortListener::errorOccurred, [](const QString &err) {
-        qWarning() << "Port Error:" << err;
-    });
+    // Создаём объекты
+    SnmpConverter *m_snmp = new SnmpConverter(subnetMask, gateway, listenAddress);
+    // Получатели: [Destination.1], [Destination.2] ...; без них - [SNMP] ipAddress/port
+    foreach (const QString &group, settings.childGroups()) {
+        DestinationConfig destination;
+        if (group.startsWith("Destination.") && configurateDestination(destination, settings, group)) {
+            m_snmp->addDestination(destination);
+        }
+    }
+    if (m_snmp->destinationCount() == 0) {
+        DestinationConfig destination;
+        destination.address = snmpIp;
+        destination.port = snmpPort;
+        m_snmp->addDestination(destination);
+    }
+    m_snmp->setMaxPduSize(maxPduSize);
+    m_snmp->setRouteRefreshInterval(routeRefreshSec * 1000);
+    m_snmp->setCoalescing(coalesceWindowMs, coalesceMaxVarbinds);
+    configurateFilter(m_snmp->filter(), settings);
+    // Датаграммы записываются (для сравнения с эталоном) вместо отправки
+    DatagramCapture datagramCapture;
+    bool captureOutput = !replayFile.isEmpty() && (!replayOutput.isEmpty() || !replayGolden.isEmpty());
+    if (captureOutput) {
+        m_snmp->setSink(&datagramCapture);
+        if (coalesceWindowMs > 0) {
+            qWarning() << "Replay with coalesceWindowMs" << coalesceWindowMs << ": message boundaries depend on timing";
+        }
+        // Принудительное обновление идёт по часам процесса, а не capture: результат зависел бы от --speed
+        UpdateFilter &filter = m_snmp->filter();
+        if (filter.isEnabled() && filter.refreshInterval() > 0) {
+            qWarning() << "Replay output is captured: filter refreshSec" << filter.refreshInterval() / 1000 << "is disabled";
+            filter.setRefreshInterval(0);
+        }
+    }
     QObject::connect(m_snmp, &SnmpConverter::errorOccurred, [](const QString &err) {
         qWarning() << "SNMP Error:" << err;
     });
 
-    // Открываем порт
-    m_port->connectPort();
+    // Уведомления несут sysUpTime и уходят мимо datagramCapture: при сравнении не отправляются
+    if (settings.value("Trap/enabled", false).toBool() && captureOutput) {
+        qWarning() << "Notifications are disabled while the replay output is captured";
+    } else if (settings.value("Trap/enabled", false).toBool()) {
+        SnmpNotifier *m_notifier = new SnmpNotifier(m_snmp->store(), m_snmp);
+        configurateNotifier(m_notifier, settings, snmpIp);
+        QObject::connect(m_notifier, &SnmpNotifier::errorOccurred, [](const QString &err) {
+            qWarning() << "SNMP Notification Error:" << err;
+        });
+        m_snmp->setNotifier(m_notifier);
+    }
+
+    // Режим агента: ответы на GET/GETNEXT/GETBULK из кэша последних значений
+    SnmpAgent *m_agent = nullptr;
+    if (settings.value("Agent/enabled", false).toBool()) {
+        QHostAddress agentAddress;
+        if (!agentAddress.setAddress(settings.value("Agent/listenAddress", "0.0.0.0").toString())) {
+            qWarning() << "Invalid agent listen address, using default: 0.0.0.0";
+            agentAddress = QHostAddress::AnyIPv4;
+        }
+        quint16 agentPort = settings.value("Agent/port", 161).toUInt();
+        QString agentCommunity = settings.value("Agent/community", "public").toString();
+        m_agent = new SnmpAgent(m_snmp->store(), agentCommunity, m_snmp);
+        m_agent->setMaxResponseSize(maxPduSize);
+        // SET - только с этим community (пусто - SET не обслуживается)
+        m_agent->setWriteCommunity(settings.value("Agent/writeCommunity", "").toString());
+        QObject::connect(m_agent, &SnmpAgent::errorOccurred, [](const QString &err) {
+            qWarning() << "SNMP Agent Error:" << err;
+        });
+        m_agent->listen(agentAddress, agentPort);
+        // Без рассылки значения только сохраняются и отдаются по запросу
+        m_snmp->setSendUpdates(settings.value("Agent/sendUpdates", true).toBool());
+    }
+
+    // Счётчики и задержки по этапам: HTTP (текстовый формат) и объекты SNMP в кэше агента
+    if (settings.value("Metrics/enabled", false).toBool()) {
+        QHostAddress metricsAddress;
+        if (!metricsAddress.setAddress(settings.value("Metrics/listenAddress", "127.0.0.1").toString())) {
+            qWarning() << "Invalid metrics listen address, using default: 127.0.0.1";
+            metricsAddress = QHostAddress::LocalHost;
+        }
+        MetricsServer *m_metrics = new MetricsServer(m_snmp);
+        QObject::connect(m_metrics, &MetricsServer::errorOccurred, [](const QString &err) {
+            qWarning() << "Metrics Error:" << err;
+        });
+        m_metrics->listen(metricsAddress, settings.value("Metrics/port", 9100).toUInt());
+        if (settings.value("Metrics/snmp", true).toBool()) {
+            m_metrics->setStore(m_snmp->store(),
+                                settings.value("Metrics/publishIntervalMs", MetricsServer::DEFAULT_PUBLISH_INTERVAL_MS).toInt());
+        }
+    }
+
+    // Тёплый перезапуск: последние значения из отображённого в память файла доступны сразу
+    if (settings.value("State/enabled", false).toBool() && replayFile.isEmpty()) {
+        StateFile *m_state = new StateFile(settings.value("State/file", "/var/tmp/rs485.state").toString(), m_snmp);
+        QObject::connect(m_state, &StateFile::errorOccurred, [](const QString &err) {
+            qWarning() << "State File Error:" << err;
+        });
+        m_state->setSyncInterval(settings.value("State/syncIntervalMs", StateFile::DEFAULT_SYNC_INTERVAL_MS).toInt());
+        if (m_state->open()) {
+            QElapsedTimer restoreClock;
+            restoreClock.start();
+            int restored = m_snmp->setStateFile(m_state, settings.value("State/announce", true).toBool(),
+                                                settings.value("State/maxAgeSec", 0).toInt());
+            qDebug() << "State restored:" << restored << "values from" << m_state->fileName()
+                     << "in" << restoreClock.nsecsElapsed() / 1000 << "us";
+        }
+    }
+
+    // Порты читаются в потоках ввода-вывода, конвертация и отправка - в главном
+    Gateway *m_gateway = new Gateway(m_snmp, ioThreads);
+    m_gateway->setStatsInterval(statsIntervalSec * 1000);
+    if (replayFile.isEmpty()) {
+        PollConfig pollConfig;
+        configuratePoll(pollConfig, settings);
+        foreach (const QString &group, portGroups) {
+            PortConfig port;
+            port.poll = pollConfig;
+            configurateSettings(port, settings, group, listenAddress);
+            m_gateway->addPort(port);
+        }
+    } else {
+        PortConfig port;
+        port.listenAddress = listenAddress;
+        port.replayFile = replayFile;
+        port.replaySpeed = replaySpeed;
+        port.queuePolicy = QueuePolicy::Block; // Без потерь: воспроизведение ждёт конвертер
+        m_gateway->addPort(port);
+    }
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, m_gateway, &Gateway::stop);
+    // SET управляемых параметров уходит ведущему шины порта, который опрашивает блок
+    if (m_agent) {
+        m_agent->setCommandTarget(m_gateway, settings.value("Agent/setTimeoutMs", SnmpAgent::DEFAULT_SET_TIMEOUT_MS).toInt());
+        QObject::connect(m_gateway, &Gateway::commandFinished, m_agent, &SnmpAgent::commandFinished);
+    }
+
+    // Итоги воспроизведения: скорость, задержки, сравнение с эталоном
+    QElapsedTimer replayClock;
+    QObject::connect(m_gateway, &Gateway::replayFinished, [&]() {
+        m_gateway->stop(); // Кадры, оставшиеся в очередях
+        double seconds = replayClock.nsecsElapsed() / 1e9;
+        uint64_t frames = Metrics::counter(METRIC_FRAMES_RECEIVED);
+        const Histogram &latency = Metrics::stage(STAGE_END_TO_END);
+        qDebug() << "Replay finished:" << frames << "frames in" << seconds << "s," << (seconds > 0 ? frames / seconds : 0.0) << "frames/s";
+        qDebug() << "End-to-end latency (us): p50" << latency.percentile(50) / 1000.0 << "p90" << latency.percentile(90) / 1000.0
+                 << "p99" << latency.percentile(99) / 1000.0 << "p99.9" << latency.percentile(99.9) / 1000.0
+                 << "max" << latency.max() / 1000.0;
+        qDebug() << "SNMP messages:" << Metrics::counter(METRIC_MESSAGES) << "varbinds:" << Metrics::counter(METRIC_VARBINDS)
+                 << "datagrams:" << Metrics::counter(METRIC_DATAGRAMS_SENT);
+
+        int exitCode = 0;
+        if (captureOutput) {
+            qDebug() << "Captured datagrams:" << datagramCapture.datagrams() << "bytes:" << datagramCapture.bytes();
+            if (!replayOutput.isEmpty() && !datagramCapture.save(replayOutput)) {
+                qWarning() << "Failed to write replay output" << replayOutput;
+                exitCode = 2;
+            }
+        }
+        if (!replayGolden.isEmpty()) {
+            int line = datagramCapture.compare(replayGolden);
+            if (line == 0) {
+                qDebug() << "Output matches" << replayGolden;
+            } else if (line < 0) {
+                qWarning() << "Cannot read golden file" << replayGolden;
+                exitCode = 2;
+            } else {
+                qWarning() << "Output differs from" << replayGolden << "at line" << line;
+                exitCode = 1;
+            }
+        }
+        if (replayQuit) {
+            QCoreApplication::exit(exitCode);
+        }
+    });
+    replayClock.start();
+    m_gateway->start();
 
-    return a.exec();
+    int result = a.exec();
+    Log::stop();
+    return result;
 }
@@ -0,0 +1,76 @@
+#include "metrics.h"
+
+std::atomic<uint64_t> Metrics::s_counters[METRIC_COUNTER_COUNT] = {};
+Histogram Metrics::s_stages[STAGE_COUNT];
+
+namespace {
+
+const char *const COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+    "serial_bytes_received",
+    "sci_frames_received",
+    "serial_bytes_discarded",
+    "sci_frames_decoded",
+    "sci_frames_rejected",
+    "sci_crc_errors",
+    "sci_frames_ignored",
+    "snmp_varbinds",
+    "snmp_messages",
+    "udp_datagrams_sent",
+    "udp_errors",
+    "poll_queries",
+    "poll_timeouts",
+    "control_commands",
+    "control_coalesced",
+    "control_failed",
+    "route_cache_hits",
+    "route_cache_refreshes"
+};
+
+const char *const STAGE_NAMES[STAGE_COUNT] = {
+    "serial_read",
+    "queue",
+    "decode",
+    "encode",
+    "send",
+    "end_to_end",
+    "poll_round_trip",
+    "poll_cycle",
+    "control"
+};
+
+const double QUANTILES[] = {50, 90, 99, 99.9};
+
+} // namespace
+
+const char *Metrics::counterName(MetricCounter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+const char *Metrics::stageName(MetricStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+QByteArray Metrics::text() {
+    QByteArray out;
+    out.reserve(4096);
+    char line[256];
+    for (int i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+        int length = qsnprintf(line, sizeof(line), "rs485_%s_total %llu\n", COUNTER_NAMES[i],
+                               static_cast<unsigned long long>(counter(static_cast<MetricCounter>(i))));
+        out.append(line, length);
+    }
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        const Histogram &histogram = s_stages[i];
+        for (double quantile : QUANTILES) {
+            int length = qsnprintf(line, sizeof(line), "rs485_latency_us{stage=\"%s\",quantile=\"%g\"} %.3f\n",
+                                   STAGE_NAMES[i], quantile / 100.0, histogram.percentile(quantile) / 1000.0);
+            out.append(line, length);
+        }
+        int length = qsnprintf(line, sizeof(line),
+                               "rs485_latency_us_max{stage=\"%s\"} %.3f\nrs485_latency_us_sum{stage=\"%s\"} %.3f\nrs485_latency_us_count{stage=\"%s\"} %llu\n",
+                               STAGE_NAMES[i], histogram.max() / 1000.0, STAGE_NAMES[i], histogram.sum() / 1000.0,
+                               STAGE_NAMES[i], static_cast<unsigned long long>(histogram.count()));
+        out.append(line, length);
+    }
+    return out;
+}
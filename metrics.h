@@ -0,0 +1,78 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <QByteArray>
+#include "histogram.h"
+
+// Pipeline counters
+enum MetricCounter {
+    METRIC_BYTES_RECEIVED,   // Serial bytes read
+    METRIC_FRAMES_RECEIVED,  // Complete SCI frames from the reassembler
+    METRIC_BYTES_DISCARDED,  // Serial bytes skipped while resynchronising on STX
+    METRIC_FRAMES_DECODED,   // Frames accepted by sciDecode()
+    METRIC_FRAMES_REJECTED,  // Frames rejected by sciDecode() (any reason)
+    METRIC_CRC_ERRORS,       // Frames with a bad CRC (reassembler and sciDecode())
+    METRIC_FRAMES_IGNORED,   // Valid frames from a source that is not listened to
+    METRIC_VARBINDS,         // Varbinds put into messages
+    METRIC_MESSAGES,         // SNMP messages built
+    METRIC_DATAGRAMS_SENT,   // Datagrams accepted by the kernel (all destinations)
+    METRIC_UDP_ERRORS,       // Datagrams rejected or dropped by the senders
+    METRIC_POLL_QUERIES,     // Bus master queries written (retries included)
+    METRIC_POLL_TIMEOUTS,    // Bus master queries given up without a reply
+    METRIC_CONTROL_COMMANDS, // Control commands (SNMP SET) written to the bus
+    METRIC_CONTROL_COALESCED,// ... merged into a waiting command for the same parameter
+    METRIC_CONTROL_FAILED,   // ... refused (NACK), not answered or never sent
+    METRIC_ROUTE_HITS,       // Next-hop lookups served from the route cache
+    METRIC_ROUTE_REFRESHES,  // Network interface enumerations of the route cache
+    METRIC_COUNTER_COUNT
+};
+
+// Pipeline stages with a latency histogram (nanoseconds)
+enum MetricStage {
+    STAGE_SERIAL_READ, // One readyRead handler: read, reassemble, queue
+    STAGE_QUEUE,       // Frame waiting in the frame queue
+    STAGE_DECODE,      // sciDecode() and varbind collection of one frame
+    STAGE_ENCODE,      // BER encoding of one message
+    STAGE_SEND,        // One UdpSender::flush() with datagrams to send
+    STAGE_END_TO_END,  // readyRead of the oldest frame of a message to its datagram leaving (per destination)
+    STAGE_POLL_ROUND_TRIP, // Bus master query written to its reply read
+    STAGE_POLL_CYCLE,      // Bus master: every query due at the start of a cycle done
+    STAGE_CONTROL,         // Control command queued to its ACK/NACK
+    STAGE_COUNT
+};
+
+/*
+Process-wide metrics: relaxed atomic counters and log-linear latency histograms.
+Updated from the serial I/O threads and the converter thread without locks;
+read by MetricsServer (HTTP text and SNMP objects) and the periodic statistics.
+*/
+class Metrics {
+public:
+    static void add(MetricCounter counter, uint64_t value = 1) {
+        s_counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+    static uint64_t counter(MetricCounter counter) { return s_counters[counter].load(std::memory_order_relaxed); }
+    static void record(MetricStage stage, int64_t nanoseconds) {
+        s_stages[stage].record(nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0);
+    }
+    static const Histogram &stage(MetricStage stage) { return s_stages[stage]; }
+
+    // Monotonic clock shared by all threads, nanoseconds
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static const char *counterName(MetricCounter counter);
+    static const char *stageName(MetricStage stage);
+    // Prometheus-style text exposition of all counters and stages (latencies in microseconds)
+    static QByteArray text();
+
+private:
+    static std::atomic<uint64_t> s_counters[METRIC_COUNTER_COUNT];
+    static Histogram s_stages[STAGE_COUNT];
+};
+
+#endif // METRICS_H
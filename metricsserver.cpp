@@ -0,0 +1,93 @@
+#include "metricsserver.h"
+#include <QTcpSocket>
+#include <QDebug>
+#include "metrics.h"
+#include "snmpoids.h"
+
+static_assert(METRIC_COUNTER_COUNT < MetricsServer::STAGE_OID_BASE, "Counter OIDs run into the stage latency OIDs");
+static_assert(MetricsServer::STAGE_OID_BASE + 3 * STAGE_COUNT <= 128, "Stage latency OIDs do not fit into one arc byte");
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent), m_server(new QTcpServer(this)), m_publishTimer(this) {
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnections);
+    connect(&m_publishTimer, &QTimer::timeout, this, &MetricsServer::publish);
+}
+
+bool MetricsServer::listen(const QHostAddress &address, quint16 port) {
+    if (!m_server->listen(address, port)) {
+        QString err = "Metrics endpoint failed to listen on " + address.toString() + ":" + QString::number(port) + ": " + m_server->errorString();
+        qWarning() << err;
+        emit errorOccurred(err);
+        return false;
+    }
+    qDebug() << "Metrics endpoint on http://" + address.toString() + ":" + QString::number(port) + "/metrics";
+    return true;
+}
+
+void MetricsServer::setStore(OidStore *store, int intervalMs) {
+    m_store = store;
+    if (m_store && intervalMs > 0) {
+        publish();
+        m_publishTimer.start(intervalMs);
+    } else {
+        m_publishTimer.stop();
+    }
+}
+
+void MetricsServer::publish() {
+    if (!m_store) {
+        return;
+    }
+    for (int i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+        uint64_t value = Metrics::counter(static_cast<MetricCounter>(i));
+        m_store->set(makeMibOid(MIB_METRICS, static_cast<uint8_t>(1 + i)), SnmpValue::counter32(static_cast<uint32_t>(value)));
+    }
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        const Histogram &histogram = Metrics::stage(static_cast<MetricStage>(i));
+        uint8_t index = static_cast<uint8_t>(STAGE_OID_BASE + 3 * i);
+        m_store->set(makeMibOid(MIB_METRICS, index), SnmpValue::gauge32(static_cast<uint32_t>(histogram.percentile(50) / 1000)));
+        m_store->set(makeMibOid(MIB_METRICS, index + 1), SnmpValue::gauge32(static_cast<uint32_t>(histogram.percentile(99) / 1000)));
+        m_store->set(makeMibOid(MIB_METRICS, index + 2), SnmpValue::gauge32(static_cast<uint32_t>(histogram.max() / 1000)));
+    }
+}
+
+void MetricsServer::acceptConnections() {
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // A client that never completes its request does not keep the socket
+        QTimer *timeout = new QTimer(socket);
+        timeout->setSingleShot(true);
+        connect(timeout, &QTimer::timeout, socket, [socket]() {
+            socket->abort();
+            socket->deleteLater();
+        });
+        timeout->start(REQUEST_TIMEOUT_MS);
+        connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+            if (socket->state() != QAbstractSocket::ConnectedState) {
+                return; // Answered already, the rest of the request is not needed
+            }
+            if (!socket->canReadLine()) {
+                if (socket->bytesAvailable() > MAX_REQUEST_LINE) {
+                    socket->abort(); // No line end in sight, the buffer would only grow
+                    socket->deleteLater();
+                }
+                return; // Request line not complete yet
+            }
+            // "GET /metrics HTTP/1.1": headers and body of the request are not needed
+            QByteArray requestLine = socket->readLine();
+            QList<QByteArray> parts = requestLine.split(' ');
+            QByteArray path = parts.size() > 1 ? parts[1] : QByteArray();
+            if (parts[0] != "GET" || (path != "/" && path != "/metrics")) {
+                socket->write("HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            } else {
+                QByteArray body = Metrics::text();
+                QByteArray header("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: ");
+                header += QByteArray::number(body.size());
+                header += "\r\n\r\n";
+                socket->write(header);
+                socket->write(body);
+            }
+            socket->disconnectFromHost();
+        });
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTimer>
+#include "oidstore.h"
+
+/*
+Exports Metrics:
+- over HTTP: GET / or GET /metrics on listenAddress:port gets the text exposition
+  (Metrics::text()), anything else 404, and the connection is closed; a client
+  that sends no request line within REQUEST_TIMEOUT_MS or more than
+  MAX_REQUEST_LINE bytes without one is dropped; meant for a local scraper
+- as SNMP objects 1.3.6.1.4.1.58039.5.<n> in the OidStore served by SnmpAgent:
+  counters (Counter32, wrapping) at 1..METRIC_COUNTER_COUNT and per stage
+  p50 / p99 / max latency in microseconds (Gauge32) at 64 + 3 * stage + {0, 1, 2},
+  refreshed every publish interval; an index is one BER byte (below 128), which
+  leaves room for 63 counters and 21 stages
+Runs in the converter thread (the OidStore is not thread-safe).
+*/
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    static const int DEFAULT_PUBLISH_INTERVAL_MS = 1000;
+    // First OID index of the stage latencies, the counters end below it
+    static const int STAGE_OID_BASE = 64;
+    // Longest request line accepted, and how long a connection may take to send it
+    static const int MAX_REQUEST_LINE = 1024;
+    static const int REQUEST_TIMEOUT_MS = 5000;
+
+    explicit MetricsServer(QObject *parent = nullptr);
+
+    // Start the HTTP endpoint; false (and errorOccurred) on failure
+    bool listen(const QHostAddress &address, quint16 port);
+    // Publish into store every intervalMs (nullptr: no SNMP objects)
+    void setStore(OidStore *store, int intervalMs = DEFAULT_PUBLISH_INTERVAL_MS);
+
+public slots:
+    // Write the current values into the store
+    void publish();
+
+signals:
+    void errorOccurred(const QString &err);
+
+private:
+    QTcpServer *m_server;
+    OidStore *m_store = nullptr;
+    QTimer m_publishTimer;
+
+    void acceptConnections();
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,57 @@
+#include "oidstore.h"
+
+OidStore::OidStore(int expectedSize) {
+    m_entries.reserve(expectedSize);
+}
+
+int OidStore::lowerBound(const SnmpOid &oid) const {
+    int low = 0;
+    int high = static_cast<int>(m_entries.size());
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (snmpOidCompare(m_entries[middle].oid, oid) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void OidStore::set(const SnmpOid &oid, const SnmpValue &value) {
+    ++m_updates;
+    int index = lowerBound(oid);
+    if (index == size() || snmpOidCompare(m_entries[index].oid, oid) != 0) {
+        Entry entry{};
+        entry.oid = oid;
+        m_entries.insert(m_entries.begin() + index, entry);
+    }
+
+    Entry &entry = m_entries[index];
+    entry.type = value.type;
+    entry.number = value.number;
+    int length = value.type == BER_OCTET_STRING ? value.length : 0;
+    if (length > MAX_STRING_LENGTH) {
+        length = MAX_STRING_LENGTH;
+    }
+    for (int i = 0; i < length; ++i) {
+        entry.text[i] = value.string[i];
+    }
+    entry.length = static_cast<uint8_t>(length);
+}
+
+const OidStore::Entry *OidStore::find(const SnmpOid &oid) const {
+    int index = lowerBound(oid);
+    if (index < size() && snmpOidCompare(m_entries[index].oid, oid) == 0) {
+        return &m_entries[index];
+    }
+    return nullptr;
+}
+
+const OidStore::Entry *OidStore::next(const SnmpOid &oid) const {
+    int index = lowerBound(oid);
+    if (index < size() && snmpOidCompare(m_entries[index].oid, oid) == 0) {
+        ++index;
+    }
+    return index < size() ? &m_entries[index] : nullptr;
+}
@@ -0,0 +1,62 @@
+#ifndef OIDSTORE_H
+#define OIDSTORE_H
+
+#include <cstdint>
+#include <vector>
+#include "snmpoids.h"
+#include "snmpvalue.h"
+
+/*
+Last known value of every object, ordered by OID.
+Updated in place by the SCI decode path (SnmpConverter) and read by the agent:
+GET is a binary search, GETNEXT the entry after the binary search position.
+Entries are fixed-size and stored contiguously; a new OID is inserted at its
+sorted position once, every later update of that OID only overwrites the value.
+Not thread-safe: the converter and the agent live in the same thread.
+*/
+class OidStore {
+public:
+    // Longest OCTET STRING value kept (longer strings are truncated)
+    static const int MAX_STRING_LENGTH = 32;
+
+    struct Entry {
+        SnmpOid oid;
+        uint8_t type;
+        uint8_t length;
+        uint32_t number;
+        char text[MAX_STRING_LENGTH];
+
+        // Value view, OCTET STRING points into text
+        SnmpValue value() const {
+            SnmpValue v;
+            v.type = type;
+            v.number = number;
+            v.string = text;
+            v.length = length;
+            return v;
+        }
+    };
+
+    explicit OidStore(int expectedSize = 128);
+
+    // Insert or update in place
+    void set(const SnmpOid &oid, const SnmpValue &value);
+    // Exact match, nullptr if the OID has no value yet
+    const Entry *find(const SnmpOid &oid) const;
+    // First entry after oid in OID order, nullptr at the end of the MIB view
+    const Entry *next(const SnmpOid &oid) const;
+
+    int size() const { return static_cast<int>(m_entries.size()); }
+    const Entry &at(int index) const { return m_entries[index]; }
+    // Number of set() calls
+    uint64_t updates() const { return m_updates; }
+
+private:
+    std::vector<Entry> m_entries;
+    uint64_t m_updates = 0;
+
+    // Index of the first entry not less than oid
+    int lowerBound(const SnmpOid &oid) const;
+};
+
+#endif // OIDSTORE_H
@@ -0,0 +1,425 @@
+#include "pollscheduler.h"
+#include <QIODevice>
+#include <QStringList>
+#include <QMutexLocker>
+#include <QDebug>
+#include "sciprotocol.h"
+#include "log.h"
+#include "metrics.h"
+
+namespace {
+
+const uint8_t CMD_UPDATE = 0x8;
+const int64_t NS_PER_MS = 1000000;
+
+} // namespace
+
+QVector<PollItem> PollConfig::defaultItems() {
+    return {
+        {0x09, 1000},   // UPD: alarms, temperature, gain, power
+        {0x0C, 1000},   // System and switch alarms
+        {0x06, 5000},   // Redundant system status
+        {0x19, 5000},   // Input DC voltage
+        {0x17, 30000},  // LO frequency
+        {0x18, 30000},  // Output frequency
+        {0x03, 60000},  // Frequency band
+        {0x00, 600000}, // SW version
+        {0x21, 600000}  // Host name
+    };
+}
+
+bool PollConfig::parseItems(const QString &text, QVector<PollItem> &items) {
+    QVector<PollItem> parsed;
+    foreach (const QString &entry, text.split(',')) {
+        if (entry.trimmed().isEmpty()) {
+            continue;
+        }
+        bool subOk = false;
+        bool periodOk = false;
+        QString subStr = entry.section(':', 0, 0).trimmed();
+        uint subCommand = (subStr.startsWith("0x") ? subStr.mid(2) : subStr).toUInt(&subOk, 16);
+        int periodMs = entry.section(':', 1, 1).trimmed().toInt(&periodOk);
+        if (!subOk || subCommand > 0xFF || !periodOk || periodMs <= 0) {
+            return false;
+        }
+        parsed.append(PollItem{static_cast<uint8_t>(subCommand), periodMs});
+    }
+    if (parsed.isEmpty()) {
+        return false;
+    }
+    items = parsed;
+    return true;
+}
+
+PollScheduler::PollScheduler(const PollConfig &config, QObject *parent)
+    : QObject(parent), m_config(config), m_timer(this) {
+    for (uint8_t address : m_config.units) {
+        std::unique_ptr<Unit> unit(new Unit);
+        unit->address = address & 0x0F;
+        m_units.push_back(std::move(unit));
+    }
+    for (int unit = 0; unit < unitCount(); ++unit) {
+        for (const PollItem &item : m_config.items) {
+            m_items.push_back(Item{unit, item.subCommand, item.periodMs * NS_PER_MS, 0, false});
+        }
+    }
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer); // Timeouts of a few ms
+    connect(&m_timer, &QTimer::timeout, this, &PollScheduler::onTimer);
+}
+
+PollScheduler::~PollScheduler() {
+    stop();
+}
+
+void PollScheduler::start(QIODevice *device) {
+    if (m_items.empty()) {
+        qWarning() << "Bus master: nothing to poll";
+        return;
+    }
+    m_device = device;
+    int64_t now = Metrics::now();
+    for (Item &item : m_items) {
+        item.dueNs = now;
+        item.inCycle = false;
+    }
+    m_cycleRemaining = 0;
+    m_state = State::Idle;
+    qDebug() << "Bus master started:" << unitCount() << "units," << m_config.items.size() << "queries per unit";
+    sendNext();
+}
+
+void PollScheduler::stop() {
+    m_timer.stop();
+    m_state = State::Stopped;
+    m_current = -1;
+    // Nothing is written any more: waiting requests get their answer now
+    std::vector<Command> queue;
+    {
+        QMutexLocker lock(&m_queueLock);
+        queue.swap(m_queue);
+    }
+    if (m_commandOnBus) {
+        m_commandOnBus = false;
+        queue.push_back(m_command);
+    }
+    for (const Command &command : queue) {
+        m_commandsFailed.fetch_add(1, std::memory_order_relaxed);
+        Metrics::add(METRIC_CONTROL_FAILED);
+        reportCommand(command, SciControlResult::Rejected);
+    }
+}
+
+bool PollScheduler::servesUnit(uint8_t address) const {
+    for (const std::unique_ptr<Unit> &unit : m_units) {
+        if (unit->address == (address & 0x0F)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PollScheduler::submitCommand(uint8_t address, int control, int32_t value, uint64_t token) {
+    int unit = -1;
+    for (int i = 0; i < unitCount(); ++i) {
+        if (m_units[i]->address == (address & 0x0F)) {
+            unit = i;
+        }
+    }
+    if (unit < 0 || control < 0 || control >= SCI_CONTROL_COUNT) {
+        return false;
+    }
+    {
+        QMutexLocker lock(&m_queueLock);
+        // Not on the bus yet: write only the newest value
+        for (Command &waiting : m_queue) {
+            if (waiting.unit == unit && waiting.control == control) {
+                waiting.value = value;
+                waiting.tokens.append(token);
+                m_commandsCoalesced.fetch_add(1, std::memory_order_relaxed);
+                Metrics::add(METRIC_CONTROL_COALESCED);
+                return true;
+            }
+        }
+        if (m_queue.size() >= static_cast<size_t>(MAX_PENDING_COMMANDS)) {
+            return false;
+        }
+        m_queue.push_back(Command{unit, control, value, m_sequence++, Metrics::now(), {token}});
+    }
+    QMetaObject::invokeMethod(this, "wakeUp", Qt::QueuedConnection);
+    return true;
+}
+
+void PollScheduler::wakeUp() {
+    if (m_state == State::Idle) {
+        m_timer.stop();
+        sendNext();
+    }
+}
+
+bool PollScheduler::takeCommand() {
+    QMutexLocker lock(&m_queueLock);
+    if (m_queue.empty()) {
+        return false;
+    }
+    size_t best = 0;
+    for (size_t i = 1; i < m_queue.size(); ++i) {
+        int priority = SCI_CONTROLS[m_queue[i].control].priority;
+        int bestPriority = SCI_CONTROLS[m_queue[best].control].priority;
+        if (priority > bestPriority || (priority == bestPriority && m_queue[i].sequence < m_queue[best].sequence)) {
+            best = i;
+        }
+    }
+    m_command = m_queue[best];
+    m_queue.erase(m_queue.begin() + best);
+    m_commandOnBus = true;
+    return true;
+}
+
+int64_t PollScheduler::readyNs(const Item &item) const {
+    const Unit &unit = *m_units[item.unit];
+    if (unit.offline.load(std::memory_order_relaxed) && unit.offlineUntilNs > item.dueNs) {
+        return unit.offlineUntilNs;
+    }
+    return item.dueNs;
+}
+
+void PollScheduler::sendNext() {
+    if (m_state == State::Stopped) {
+        return;
+    }
+    int64_t now = Metrics::now();
+    if (takeCommand()) {
+        m_attempt = 0;
+        writeCommand(now);
+        return;
+    }
+    if (m_cycleRemaining == 0) {
+        // New cycle: whatever is due now; what becomes due meanwhile waits for the next one
+        int64_t nextReady = INT64_MAX;
+        for (Item &item : m_items) {
+            int64_t ready = readyNs(item);
+            item.inCycle = ready <= now;
+            if (item.inCycle) {
+                ++m_cycleRemaining;
+            } else {
+                nextReady = qMin(nextReady, ready);
+            }
+        }
+        if (m_cycleRemaining == 0) {
+            m_state = State::Idle;
+            m_timer.start(static_cast<int>((nextReady - now + NS_PER_MS - 1) / NS_PER_MS));
+            return;
+        }
+        m_cycleStartNs = now;
+    }
+    // Of the cycle the item most late relative to its own period
+    int best = -1;
+    double bestLateness = -1;
+    for (int i = 0; i < static_cast<int>(m_items.size()); ++i) {
+        const Item &item = m_items[i];
+        if (!item.inCycle) {
+            continue;
+        }
+        double lateness = static_cast<double>(now - item.dueNs) / item.periodNs;
+        if (lateness > bestLateness) {
+            bestLateness = lateness;
+            best = i;
+        }
+    }
+    m_current = best;
+    m_attempt = 0;
+    writeQuery(now);
+}
+
+void PollScheduler::writeQuery(int64_t nowNs) {
+    const Item &item = m_items[m_current];
+    Unit &unit = *m_units[item.unit];
+    uint8_t data[] = {0xFF, item.subCommand};
+    uint8_t frame[SCI_MAX_FRAME_SIZE];
+    int size = sciEncode(static_cast<uint8_t>((unit.address << 4) | m_config.masterAddress), m_config.queryCmd,
+                         data, sizeof(data), frame);
+    writeFrame(unit, frame, size, nowNs);
+    unit.queries.fetch_add(1, std::memory_order_relaxed);
+    Metrics::add(METRIC_POLL_QUERIES);
+    LOG_TRACE(LOG_SERIAL, "Bus master query {} sub {} attempt {}", unit.address, item.subCommand, m_attempt);
+}
+
+void PollScheduler::writeCommand(int64_t nowNs) {
+    const SciControl &control = SCI_CONTROLS[m_command.control];
+    Unit &unit = *m_units[m_command.unit];
+    uint8_t frame[SCI_MAX_FRAME_SIZE];
+    int size = sciEncodeControl(static_cast<uint8_t>((unit.address << 4) | m_config.masterAddress), m_config.controlCmd,
+                                control, m_command.value, frame);
+    writeFrame(unit, frame, size, nowNs);
+    if (m_attempt == 0) {
+        m_commands.fetch_add(1, std::memory_order_relaxed);
+        Metrics::add(METRIC_CONTROL_COMMANDS);
+    }
+    LOG_DEBUG(LOG_SERIAL, "Bus master command {} {} = {} attempt {}", unit.address, control.name, m_command.value, m_attempt);
+}
+
+void PollScheduler::writeFrame(const Unit &unit, const uint8_t *frame, int size, int64_t nowNs) {
+    m_state = State::WaitingReply;
+    m_sentNs = nowNs;
+    if (m_device->write(reinterpret_cast<const char*>(frame), size) != size) {
+        m_writeErrors.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARNING(LOG_SERIAL, "Bus master: cannot write to {}: {}", unit.address, m_device->errorString());
+    }
+    m_timer.start(m_config.responseTimeoutMs);
+}
+
+void PollScheduler::frameReceived(const uint8_t *frame, int size, int64_t receivedNs) {
+    if (m_state != State::WaitingReply) {
+        return;
+    }
+    SCIPacket pack;
+    if (sciDecode(frame, size, pack) != SciStatus::Ok) {
+        return; // Damaged reply: the timeout repeats the query
+    }
+    if (m_commandOnBus) {
+        if ((pack.destSrc & 0x0F) != m_units[m_command.unit]->address
+            || (pack.cmd != SCI_CMD_ACK && pack.cmd != SCI_CMD_NACK)) {
+            return;
+        }
+        m_timer.stop();
+        finishCommand(pack.cmd == SCI_CMD_ACK ? SciControlResult::Ack : SciControlResult::Nack, receivedNs);
+        return;
+    }
+    const Item &item = m_items[m_current];
+    if ((pack.destSrc & 0x0F) != m_units[item.unit]->address) {
+        return; // Echo of the query or another unit
+    }
+    Unit &unit = *m_units[item.unit];
+    if (pack.cmd == SCI_CMD_NACK) {
+        unit.nacks.fetch_add(1, std::memory_order_relaxed);
+    } else if (pack.cmd != CMD_UPDATE || pack.len < 2 || pack.data[0] != 0xFF || pack.data[1] != item.subCommand) {
+        return; // Unsolicited frame of the same unit
+    }
+    m_timer.stop();
+    unit.replies.fetch_add(1, std::memory_order_relaxed);
+    int64_t roundTrip = receivedNs - m_sentNs;
+    unit.roundTrip.record(roundTrip > 0 ? static_cast<uint64_t>(roundTrip / 1000) : 0);
+    Metrics::record(STAGE_POLL_ROUND_TRIP, roundTrip);
+    finish(true, receivedNs);
+}
+
+void PollScheduler::finish(bool replied, int64_t nowNs) {
+    Item &item = m_items[m_current];
+    Unit &unit = *m_units[item.unit];
+    if (replied) {
+        unit.failures = 0;
+        if (unit.offline.exchange(false, std::memory_order_relaxed)) {
+            qDebug() << "Bus master: unit" << QString::number(unit.address, 16).toUpper() << "answers again";
+        }
+    } else if (++unit.failures >= m_config.offlineAfter) {
+        unit.offlineUntilNs = nowNs + m_config.offlineRetryMs * NS_PER_MS;
+        if (!unit.offline.exchange(true, std::memory_order_relaxed)) {
+            qWarning() << "Bus master: unit" << QString::number(unit.address, 16).toUpper() << "does not answer, retry every"
+                       << m_config.offlineRetryMs << "ms";
+            // Its items do not hold up the cycle
+            for (Item &other : m_items) {
+                if (other.unit == item.unit) {
+                    leaveCycle(other, nowNs);
+                }
+            }
+        }
+    }
+    // Keep the phase while the bus keeps up, never build a backlog of missed periods
+    item.dueNs = qMax(item.dueNs + item.periodNs, m_sentNs);
+    leaveCycle(item, nowNs);
+    m_current = -1;
+
+    if (replied && m_config.turnaroundMs > 0) {
+        m_state = State::Turnaround;
+        m_timer.start(m_config.turnaroundMs);
+    } else {
+        sendNext();
+    }
+}
+
+void PollScheduler::finishCommand(SciControlResult result, int64_t nowNs) {
+    Command command = m_command;
+    m_commandOnBus = false;
+    const SciControl &control = SCI_CONTROLS[command.control];
+    Metrics::record(STAGE_CONTROL, nowNs - command.submittedNs);
+    if (result == SciControlResult::Ack) {
+        m_commandsAcked.fetch_add(1, std::memory_order_relaxed);
+        // Read the new value back with the next cycle
+        for (Item &item : m_items) {
+            if (item.unit == command.unit && item.subCommand == control.readback) {
+                item.dueNs = qMin(item.dueNs, nowNs);
+            }
+        }
+    } else {
+        if (result == SciControlResult::Nack) {
+            m_commandsNacked.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_commandsFailed.fetch_add(1, std::memory_order_relaxed);
+        }
+        Metrics::add(METRIC_CONTROL_FAILED);
+        LOG_WARNING(LOG_SERIAL, "Bus master: {} = {} to {} {}", control.name, command.value,
+                    m_units[command.unit]->address, result == SciControlResult::Nack ? "refused" : "not answered");
+    }
+    reportCommand(command, result);
+
+    if (result != SciControlResult::Timeout && m_config.turnaroundMs > 0) {
+        m_state = State::Turnaround;
+        m_timer.start(m_config.turnaroundMs);
+    } else {
+        sendNext();
+    }
+}
+
+void PollScheduler::reportCommand(const Command &command, SciControlResult result) {
+    for (uint64_t token : command.tokens) {
+        emit commandFinished(token, static_cast<int>(result));
+    }
+}
+
+void PollScheduler::leaveCycle(Item &item, int64_t nowNs) {
+    if (!item.inCycle) {
+        return;
+    }
+    item.inCycle = false;
+    if (--m_cycleRemaining == 0) {
+        int64_t cycle = nowNs - m_cycleStartNs;
+        m_cycleTime.record(static_cast<uint64_t>(cycle / 1000));
+        Metrics::record(STAGE_POLL_CYCLE, cycle);
+    }
+}
+
+void PollScheduler::onTimer() {
+    switch (m_state) {
+    case State::WaitingReply: {
+        Unit &unit = *m_units[m_commandOnBus ? m_command.unit : m_items[m_current].unit];
+        int64_t now = Metrics::now();
+        // An offline unit gets a single try per offlineRetryMs
+        if (m_attempt < m_config.retries && !unit.offline.load(std::memory_order_relaxed)) {
+            ++m_attempt;
+            unit.retries.fetch_add(1, std::memory_order_relaxed);
+            if (m_commandOnBus) {
+                writeCommand(now);
+            } else {
+                writeQuery(now);
+            }
+            return;
+        }
+        if (m_commandOnBus) {
+            finishCommand(SciControlResult::Timeout, now);
+            break;
+        }
+        unit.timeouts.fetch_add(1, std::memory_order_relaxed);
+        Metrics::add(METRIC_POLL_TIMEOUTS);
+        LOG_DEBUG(LOG_SERIAL, "Bus master: no reply from {} to sub {}", unit.address, m_items[m_current].subCommand);
+        finish(false, now);
+        break;
+    }
+    case State::Idle:
+    case State::Turnaround:
+        sendNext();
+        break;
+    case State::Stopped:
+        break;
+    }
+}
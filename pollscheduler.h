@@ -0,0 +1,207 @@
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "histogram.h"
+#include "scicontrol.h"
+
+class QIODevice;
+
+// One sub-command queried from every unit every periodMs
+struct PollItem {
+    uint8_t subCommand;
+    int periodMs;
+};
+
+/*
+Bus master settings ([Poll], enabled per port with poll=true):
+>units - addresses queried, 0xA 0xB 0xC by default
+>masterAddress - source nibble of the queries; frames from it (adapter echo) are ignored
+>queryCmd - command of a query "FF <subCommand>"; the unit answers with its 0x8 update of that sub-command or NACK
+>responseTimeoutMs, retries - a query is repeated that many times before it counts as lost
+>turnaroundMs - silence after a reply before the next query (RS485 driver turnaround)
+>offlineAfter, offlineRetryMs - a unit that lost that many queries in a row is only tried every offlineRetryMs
+>items - what is polled and how often; a shorter period means a higher priority
+>controlCmd - command of control frames (SNMP SET, see SCI_CONTROLS)
+*/
+struct PollConfig {
+    bool enabled = false;
+    QVector<uint8_t> units{0xA, 0xB, 0xC};
+    uint8_t masterAddress = 0x0;
+    uint8_t queryCmd = 0x8;
+    int responseTimeoutMs = 50;
+    int retries = 2;
+    int turnaroundMs = 2;
+    int offlineAfter = 3;
+    int offlineRetryMs = 5000;
+    uint8_t controlCmd = SCI_CONTROL_CMD;
+    QVector<PollItem> items = defaultItems();
+
+    // Status and alarms every second, measurements every few, version and host name every 10 minutes
+    static QVector<PollItem> defaultItems();
+    /*
+    Parse "09:1000, 0C:1000, 21:600000" (hex sub-command : period in ms)
+    Return: false if any entry is invalid, items unchanged
+    */
+    static bool parseItems(const QString &text, QVector<PollItem> &items);
+};
+
+/*
+Active bus master of one half-duplex RS485 port.
+Exactly one query is on the bus at a time: the next one is written when the
+reply has arrived (plus turnaroundMs) or the response timeout has expired, so
+queries never collide with replies and the bus stays busy while anything is
+due. Every (unit, sub-command) has its own period. Queries go out in cycles:
+a cycle takes everything due when it starts and sends the query most late
+relative to its period first, so fast-changing values overtake static ones;
+what falls due meanwhile waits for the next cycle, so an overloaded bus
+stretches the cycle instead of starving the static values. Units that stop
+answering are skipped except for a retry every offlineRetryMs.
+Control commands (SNMP SET) share the bus with the queries: they wait in a
+small queue, go out before the next query (highest SciControl priority
+first) and finish with the unit's ACK or NACK. A command for a (unit,
+control) that is still waiting takes the newer value instead of queueing a
+second write, and every request that joined it gets the same result.
+Lives in the thread of the PortListener that feeds it every received frame.
+*/
+class PollScheduler : public QObject {
+    Q_OBJECT
+public:
+    // Commands waiting for the bus, submitCommand() fails beyond that
+    static const int MAX_PENDING_COMMANDS = 16;
+
+    explicit PollScheduler(const PollConfig &config, QObject *parent = nullptr);
+    ~PollScheduler();
+
+    // Start querying through the (open, writable) device
+    void start(QIODevice *device);
+    void stop();
+    // Every complete frame read from the bus; receivedNs - Metrics::now() of the read
+    void frameReceived(const uint8_t *frame, int size, int64_t receivedNs);
+    bool servesUnit(uint8_t address) const;
+    /*
+    Queue SCI_CONTROLS[control] = value for the unit, safe to call from any thread;
+    commandFinished(token, ...) follows unless it returns false (unit not polled here, queue full)
+    */
+    bool submitCommand(uint8_t address, int control, int32_t value, uint64_t token);
+
+    // Statistics, safe to read from any thread
+    int unitCount() const { return static_cast<int>(m_units.size()); }
+    uint8_t unitAddress(int unit) const { return m_units[unit]->address; }
+    uint64_t queries(int unit) const { return m_units[unit]->queries.load(std::memory_order_relaxed); }
+    uint64_t replies(int unit) const { return m_units[unit]->replies.load(std::memory_order_relaxed); }
+    uint64_t nacks(int unit) const { return m_units[unit]->nacks.load(std::memory_order_relaxed); }
+    // Queries repeated after a response timeout
+    uint64_t retries(int unit) const { return m_units[unit]->retries.load(std::memory_order_relaxed); }
+    // Queries given up after all retries
+    uint64_t timeouts(int unit) const { return m_units[unit]->timeouts.load(std::memory_order_relaxed); }
+    bool isOffline(int unit) const { return m_units[unit]->offline.load(std::memory_order_relaxed); }
+    // Query written to the reply read, microseconds
+    const Histogram &roundTrip(int unit) const { return m_units[unit]->roundTrip; }
+    // One cycle: every query due when the cycle started answered or given up, microseconds
+    const Histogram &cycleTime() const { return m_cycleTime; }
+    uint64_t writeErrors() const { return m_writeErrors.load(std::memory_order_relaxed); }
+    // Control commands written (retries not counted), merged into a waiting one, acknowledged, refused, lost
+    uint64_t commands() const { return m_commands.load(std::memory_order_relaxed); }
+    uint64_t commandsCoalesced() const { return m_commandsCoalesced.load(std::memory_order_relaxed); }
+    uint64_t commandsAcked() const { return m_commandsAcked.load(std::memory_order_relaxed); }
+    uint64_t commandsNacked() const { return m_commandsNacked.load(std::memory_order_relaxed); }
+    uint64_t commandsFailed() const { return m_commandsFailed.load(std::memory_order_relaxed); }
+
+signals:
+    // Command of token finished; result is a SciControlResult
+    void commandFinished(quint64 token, int result);
+
+private:
+    enum class State {
+        Stopped,
+        Idle,         // Nothing due, the timer fires at the next due time
+        WaitingReply, // Timer is the response timeout
+        Turnaround    // Reply received, timer is the gap before the next query
+    };
+    struct Unit {
+        uint8_t address;
+        std::atomic<uint64_t> queries{0};
+        std::atomic<uint64_t> replies{0};
+        std::atomic<uint64_t> nacks{0};
+        std::atomic<uint64_t> retries{0};
+        std::atomic<uint64_t> timeouts{0};
+        std::atomic<bool> offline{false};
+        Histogram roundTrip;
+        int failures = 0;          // Queries lost in a row
+        int64_t offlineUntilNs = 0;
+    };
+    struct Item {
+        int unit;             // In m_units
+        uint8_t subCommand;
+        int64_t periodNs;
+        int64_t dueNs;
+        bool inCycle;         // Due when the current cycle started, not queried yet
+    };
+    struct Command {
+        int unit;                     // In m_units
+        int control;                  // In SCI_CONTROLS
+        int32_t value;
+        uint64_t sequence;            // Order of arrival among equal priorities
+        int64_t submittedNs;
+        QVector<uint64_t> tokens;     // Requests waiting for the result
+    };
+
+    PollConfig m_config;
+    QIODevice *m_device = nullptr;
+    QTimer m_timer;
+    State m_state = State::Stopped;
+    std::vector<std::unique_ptr<Unit>> m_units;
+    std::vector<Item> m_items;
+
+    int m_current = -1;        // Item of the query on the bus
+    bool m_commandOnBus = false; // m_command is on the bus instead of an item
+    Command m_command;
+    int m_attempt = 0;         // Retries of the current query so far
+    int64_t m_sentNs = 0;      // Metrics::now() of the current query
+    int64_t m_cycleStartNs = 0;
+    int m_cycleRemaining = 0;  // Items with inCycle, 0 - no cycle running
+    Histogram m_cycleTime;
+    std::atomic<uint64_t> m_writeErrors{0};
+
+    QMutex m_queueLock;        // m_queue is filled from other threads
+    std::vector<Command> m_queue;
+    uint64_t m_sequence = 0;
+    std::atomic<uint64_t> m_commands{0};
+    std::atomic<uint64_t> m_commandsCoalesced{0};
+    std::atomic<uint64_t> m_commandsAcked{0};
+    std::atomic<uint64_t> m_commandsNacked{0};
+    std::atomic<uint64_t> m_commandsFailed{0};
+
+    // Waiting command first, then the most urgent item of the cycle, or wait for the next due time
+    void sendNext();
+    void writeQuery(int64_t nowNs);
+    // Move the most urgent waiting command to m_command; false if there is none
+    bool takeCommand();
+    void writeCommand(int64_t nowNs);
+    // Write a query or command for unit and wait for the reply
+    void writeFrame(const Unit &unit, const uint8_t *frame, int size, int64_t nowNs);
+    // Command on the bus answered (ACK/NACK) or given up
+    void finishCommand(SciControlResult result, int64_t nowNs);
+    // Report result to every request of the command
+    void reportCommand(const Command &command, SciControlResult result);
+    // Current query answered (replied) or given up
+    void finish(bool replied, int64_t nowNs);
+    // Item queried (or its unit went offline): the cycle ends with its last item
+    void leaveCycle(Item &item, int64_t nowNs);
+    // Earliest time the item may be queried (offline units wait for their retry)
+    int64_t readyNs(const Item &item) const;
+
+private slots:
+    void onTimer();
+    // Command queued from another thread: start it if the bus is idle
+    void wakeUp();
+};
+
+#endif // POLLSCHEDULER_H
@@ -1,8 +1,13 @@
 #include "portlistener.h"
+#include <QCoreApplication>
 #include <QDebug>
+#include "log.h"
+#include "metrics.h"
 
-PortListener::PortListener(const portSettings &config, QObject *parent) : QObject(parent) {
+PortListener::PortListener(const portSettings &config, QObject *parent) : QObject(parent), m_recorder(this) {
     m_serialPort = new QSerialPort(this); // Allocating memory
+    m_device = m_serialPort;
+    m_name = config.name;
     writeSettingsPort(config); // Configurate serial port
     connect(m_serialPort, &QSerialPort::readyRead, this, &PortListener::readSerialData);
     connect(m_serialPort, &QSerialPort::errorOccurred, this, [](QSerialPort::SerialPortError error) {
@@ -13,13 +18,32 @@ PortListener::PortListener(const portSettings &config, QObject *parent) : QObjec
     qDebug() << "PortListener created";
 }
 
+PortListener::PortListener(const QString &replayFile, double speed, QObject *parent) : QObject(parent), m_recorder(this) {
+    CaptureReplay *replay = new CaptureReplay(replayFile, speed, this);
+    m_device = replay;
+    m_name = replayFile;
+    connect(replay, &QIODevice::readyRead, this, &PortListener::readSerialData);
+    connect(replay, &CaptureReplay::replayFinished, this, &PortListener::replayFinished);
+    qDebug() << "PortListener created, replaying" << replayFile << "at" << (speed > 0 ? QString::number(speed) + "x" : QString("max")) << "speed";
+}
+
 PortListener::~PortListener() {
-    if (m_serialPort->isOpen()) {
-        m_serialPort->close();
+    if (m_poller) {
+        m_poller->stop();
+    }
+    if (m_device->isOpen()) {
+        m_device->close();
     }
     qDebug() << "PortListener destroyed";
 }
 
+void PortListener::setPollConfig(const PollConfig &config) {
+    if (!config.enabled || !m_serialPort) {
+        return;
+    }
+    m_poller = new PollScheduler(config, this);
+}
+
 void PortListener::writeSettingsPort(const portSettings &s) {
     m_serialPort->setPortName(s.name);
     if (!m_serialPort->setBaudRate(s.baudRate)) {
@@ -41,19 +65,87 @@ void PortListener::writeSettingsPort(const portSettings &s) {
 }
 
 void PortListener::connectPort() {
-    if (m_serialPort->open(QIODevice::ReadOnly)) {
-        qDebug() << "Port opened successfully";
+    if (!m_captureFile.isEmpty()) {
+        if (m_recorder.open(m_captureFile)) {
+            qDebug() << "Port" << m_name << "recorded to" << m_captureFile;
+        } else {
+            QString err = "Failed to create capture " + m_captureFile + ": " + m_recorder.errorString();
+            qWarning() << err;
+            emit errorOccurred(err);
+        }
+    }
+    if (m_device->open(m_poller ? QIODevice::ReadWrite : QIODevice::ReadOnly)) {
+        m_framer.reset();
+        qDebug() << "Port" << m_name << "opened successfully";
+        if (m_poller) {
+            m_poller->start(m_device);
+        }
     } else {
-        QString err = "Failed to open port: " + m_serialPort->errorString();
+        QString err = "Failed to open port " + m_name + ": " + m_device->errorString();
         qWarning() << err;
         emit errorOccurred(err);
     }
 }
 
+void PortListener::disconnectPort() {
+    if (m_poller) {
+        m_poller->stop();
+    }
+    if (m_device->isOpen()) {
+        m_device->close();
+    }
+    m_recorder.close();
+    moveToThread(QCoreApplication::instance()->thread());
+}
+
 void PortListener::readSerialData() {
-    QByteArray sciData = m_serialPort->readAll();
-    if (!sciData.isEmpty()) {
-        qDebug() << "Received SCI data:" << sciData.toHex(' ');
-        emit readedInfo(sciData);
+    uint8_t chunk[READ_CHUNK_SIZE];
+    uint8_t frame[SCI_MAX_FRAME_SIZE];
+    uint64_t discardedBefore = m_framer.discardedBytes();
+    uint64_t crcBefore = m_framer.crcMismatches();
+    uint64_t droppedBefore = m_queue ? m_queue->dropped() : 0;
+    int64_t readStart = Metrics::now();
+
+    qint64 bytesRead;
+    while ((bytesRead = m_device->read(reinterpret_cast<char*>(chunk), sizeof(chunk))) > 0) {
+        m_bytesRead.fetch_add(bytesRead, std::memory_order_relaxed);
+        Metrics::add(METRIC_BYTES_RECEIVED, static_cast<uint64_t>(bytesRead));
+        m_recorder.write(chunk, static_cast<int>(bytesRead));
+        LOG_TRACE(LOG_SERIAL, "{} received {}", m_name, logHex(chunk, static_cast<int>(bytesRead)));
+        int offset = 0;
+        while (offset < bytesRead) {
+            offset += m_framer.feed(chunk + offset, bytesRead - offset);
+            int frameSize = 0;
+            while (m_framer.nextFrame(frame, frameSize)) {
+                m_framesRead.fetch_add(1, std::memory_order_relaxed);
+                Metrics::add(METRIC_FRAMES_RECEIVED);
+                if (m_poller) {
+                    m_poller->frameReceived(frame, frameSize, readStart);
+                }
+                if (!m_queue) {
+                    emit readedInfo(QByteArray(reinterpret_cast<const char*>(frame), frameSize));
+                } else if (m_queue->push(frame, frameSize, readStart) && m_queue->requestNotify()) {
+                    emit framesAvailable();
+                }
+            }
+        }
+    }
+
+    uint64_t discarded = m_framer.discardedBytes() - discardedBefore;
+    if (discarded > 0) {
+        m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+        Metrics::add(METRIC_BYTES_DISCARDED, discarded);
+        LOG_WARNING(LOG_SERIAL, "{} discarded {} bytes while resynchronising on STX, total: {}", m_name, discarded, m_framer.discardedBytes());
+    }
+    uint64_t crcErrors = m_framer.crcMismatches() - crcBefore;
+    if (crcErrors > 0) {
+        m_crcErrors.store(m_framer.crcMismatches(), std::memory_order_relaxed);
+        Metrics::add(METRIC_CRC_ERRORS, crcErrors);
+        LOG_WARNING(LOG_SERIAL, "{} rejected {} frames with a bad CRC, total: {}", m_name, crcErrors, m_framer.crcMismatches());
+    }
+    if (m_queue && m_queue->dropped() != droppedBefore) {
+        LOG_WARNING(LOG_SERIAL, "{} frame queue full, dropped {} frames, total: {} depth: {} high water: {}", m_name,
+                    m_queue->dropped() - droppedBefore, m_queue->dropped(), m_queue->depth(), m_queue->highWater());
     }
+    Metrics::record(STAGE_SERIAL_READ, Metrics::now() - readStart);
 }
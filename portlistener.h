@@ -3,6 +3,11 @@
 
 #include <QObject>
 #include <QSerialPort>
+#include <atomic>
+#include "sciframereassembler.h"
+#include "framequeue.h"
+#include "capture.h"
+#include "pollscheduler.h"
 
 /*
 Contains QSerialPort settings:
@@ -29,25 +34,86 @@ public:
     Constructor sets port parameters at startup
     */
     explicit PortListener(const portSettings &config, QObject *parent = nullptr);
+    /*
+    Replay mode: the capture file is read in place of the serial port,
+    speed 1 - real time, 10, 100 ... - scaled, 0 - as fast as the pipeline takes it
+    */
+    PortListener(const QString &replayFile, double speed, QObject *parent = nullptr);
     ~PortListener();
 
+    // Port name or replay file
+    QString name() const { return m_name; }
+
+    // Statistics, safe to read from any thread
+    // Bytes read from the port
+    uint64_t bytesRead() const { return m_bytesRead.load(std::memory_order_relaxed); }
+    // Complete frames extracted
+    uint64_t framesRead() const { return m_framesRead.load(std::memory_order_relaxed); }
+    // Bytes dropped by the frame reassembler while resynchronising on STX
+    uint64_t discardedBytes() const { return m_discardedBytes.load(std::memory_order_relaxed); }
+    // STX ... ETX candidates the frame reassembler rejected for their CRC
+    uint64_t crcErrors() const { return m_crcErrors.load(std::memory_order_relaxed); }
+    /*
+    Hand frames over through the queue instead of readedInfo (listener runs in its own thread).
+    The queue must outlive the listener; call before the port is opened
+    */
+    void setFrameQueue(FrameQueue *queue) { m_queue = queue; }
+    // Record every read into a capture file (for a later replay), before the port is opened
+    void setCaptureFile(const QString &fileName) { m_captureFile = fileName; }
+    /*
+    Bus master mode: the port is opened read-write and the units are queried on
+    the schedule of config. Call before the listener is moved to its thread
+    */
+    void setPollConfig(const PollConfig &config);
+    // nullptr unless polling
+    const PollScheduler *poller() const { return m_poller; }
+    PollScheduler *poller() { return m_poller; }
+
 private:
-    // Object that provides reading from serial port
-    QSerialPort *m_serialPort;
+    // Size of the stack buffer used for one read() from the port
+    static const int READ_CHUNK_SIZE = 128;
+
+    // Object that provides reading from serial port, nullptr in replay mode
+    QSerialPort *m_serialPort = nullptr;
+    // Data source: m_serialPort or CaptureReplay
+    QIODevice *m_device;
+    QString m_name;
+    QString m_captureFile;
+    CaptureRecorder m_recorder;
+    // Bus master, nullptr - only listen to what the units send
+    PollScheduler *m_poller = nullptr;
+    // Splits the byte stream into complete SCI frames
+    SciFrameReassembler m_framer;
+    // Frames for the converter thread, nullptr - emit readedInfo
+    FrameQueue *m_queue = nullptr;
+    std::atomic<uint64_t> m_bytesRead{0};
+    std::atomic<uint64_t> m_framesRead{0};
+    std::atomic<uint64_t> m_discardedBytes{0};
+    std::atomic<uint64_t> m_crcErrors{0};
     // Configurate serial port parameters
     void writeSettingsPort(const portSettings &s);
 
 public slots:
-    // Slot that openes port in ReadOnly Mode
+    // Slot that openes port in ReadOnly Mode (ReadWrite for the bus master)
     void connectPort();
+    /*
+    Slot: stop the bus master and close the port in the listener's thread (its timers
+    and notifiers belong there), then hand the listener back to the main thread,
+    which destroys it after the I/O thread has finished
+    */
+    void disconnectPort();
     // Slot: Listener in a separate thread: listens to and transmits the read data for processing
     void readSerialData();
 
 signals:
-    // Signal: transmit readed data
+    // Signal: transmit one complete SCI frame (STX ... ETX)
     void readedInfo(const QByteArray &result);
+    // Signal: frames were put into an empty (already drained) queue, emitted once per burst
+    void framesAvailable();
     // Signal for error
     void errorOccurred(const QString &err);
+    // Signal: replay mode, the whole capture has been read
+    void replayFinished();
 };
 
 #endif // PORTLISTENER_H
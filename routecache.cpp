@@ -0,0 +1,153 @@
+#include "routecache.h"
+#include <QNetworkInterface>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+#endif
+
+RouteCache::RouteCache(const QHostAddress &subnetMask, const QHostAddress &gateway, int refreshIntervalMs, QObject *parent)
+    : QObject(parent), m_subnetMask(subnetMask), m_gateway(gateway), m_refreshTimer(this) {
+    m_localAddress = findLocalAddress();
+    ++m_refreshes;
+    Metrics::add(METRIC_ROUTE_REFRESHES);
+
+    connect(&m_refreshTimer, &QTimer::timeout, this, &RouteCache::refresh);
+    setRefreshInterval(refreshIntervalMs);
+    watchNetworkChanges();
+}
+
+RouteCache::~RouteCache() {
+#ifdef Q_OS_LINUX
+    if (m_netlinkSocket >= 0) {
+        ::close(m_netlinkSocket);
+    }
+#endif
+}
+
+void RouteCache::setRefreshInterval(int refreshIntervalMs) {
+    if (refreshIntervalMs > 0) {
+        m_refreshTimer.start(refreshIntervalMs);
+    } else {
+        m_refreshTimer.stop();
+    }
+}
+
+int RouteCache::addDestination(const QHostAddress &destination) {
+    Route route;
+    route.destination = destination;
+    resolve(route);
+    m_routes.append(route);
+    return m_routes.size() - 1;
+}
+
+void RouteCache::refresh() {
+    m_localAddress = findLocalAddress();
+    ++m_refreshes;
+    Metrics::add(METRIC_ROUTE_REFRESHES);
+    for (Route &route : m_routes) {
+        QHostAddress previousHop = route.nextHop;
+        bool wasReachable = route.reachable;
+        resolve(route);
+        if (route.nextHop != previousHop || route.reachable != wasReachable) {
+            qDebug() << "Route to" << route.destination.toString() << "changed, next hop:"
+                     << (route.reachable ? route.nextHop.toString() : QString("none"));
+        }
+    }
+    qDebug() << "Route cache refreshed: refreshes" << m_refreshes << "hits" << m_hits;
+}
+
+QHostAddress RouteCache::findLocalAddress() {
+    // Получаем локальный адрес (пример для первого интерфейса)
+    foreach (const QNetworkInterface &interface, QNetworkInterface::allInterfaces()) {
+        foreach (const QNetworkAddressEntry &entry, interface.addressEntries()) {
+            if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol) {
+                return entry.ip();
+            }
+        }
+    }
+    return QHostAddress();
+}
+
+bool RouteCache::isInSameSubnet(const QHostAddress &address) const {
+    // Проверяем, является ли адрес loopback (127.0.0.0/8)
+    if (address.isLoopback()) {
+        return true; // Loopback-адреса всегда считаются "в той же подсети"
+    }
+
+    if (address.protocol() != m_subnetMask.protocol()) {
+        return false; // Протоколы должны совпадать (IPv4 или IPv6)
+    }
+
+    if (m_localAddress.isNull()) {
+        qWarning() << "Could not determine local IP address";
+        return false;
+    }
+
+    if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+        quint32 ip = address.toIPv4Address();
+        quint32 localIp = m_localAddress.toIPv4Address();
+        quint32 mask = m_subnetMask.toIPv4Address();
+        return (ip & mask) == (localIp & mask);
+    }
+
+    // Для IPv6 (если нужно)
+    return false;
+}
+
+void RouteCache::resolve(Route &route) {
+    route.nextHop = route.destination;
+    route.reachable = true;
+    route.viaGateway = false;
+
+    if (isInSameSubnet(route.destination)) {
+        return;
+    }
+    if (m_gateway.isNull() || m_gateway == QHostAddress("0.0.0.0")) {
+        qWarning() << "Target address" << route.destination.toString() << "is not in the same subnet as configured with mask"
+                   << m_subnetMask.toString() << "and no gateway is specified";
+        route.reachable = false;
+        emit errorOccurred("Target address is not in the same subnet and no gateway is specified");
+        return;
+    }
+
+    // Если адрес не в той же подсети, отправляем через шлюз
+    qDebug() << "Target address" << route.destination.toString() << "is not in the same subnet, routing through gateway" << m_gateway.toString();
+    route.nextHop = m_gateway;
+    route.viaGateway = true;
+}
+
+void RouteCache::watchNetworkChanges() {
+#ifdef Q_OS_LINUX
+    m_netlinkSocket = ::socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_netlinkSocket < 0) {
+        qWarning() << "Netlink socket unavailable, routes are refreshed by timer only";
+        return;
+    }
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+    if (::bind(m_netlinkSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        qWarning() << "Netlink bind failed, routes are refreshed by timer only";
+        ::close(m_netlinkSocket);
+        m_netlinkSocket = -1;
+        return;
+    }
+    m_netlinkNotifier = new QSocketNotifier(m_netlinkSocket, QSocketNotifier::Read, this);
+    connect(m_netlinkNotifier, &QSocketNotifier::activated, this, &RouteCache::readNetlink);
+#endif
+}
+
+void RouteCache::readNetlink() {
+#ifdef Q_OS_LINUX
+    // Contents do not matter: any link or address event means routes must be recomputed
+    char buffer[4096];
+    while (::recv(m_netlinkSocket, buffer, sizeof(buffer), 0) > 0) {
+    }
+    refresh();
+#endif
+}
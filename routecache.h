@@ -0,0 +1,85 @@
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QVector>
+#include <QTimer>
+#include "metrics.h"
+
+class QSocketNotifier;
+
+// Next-hop decision for one SNMP destination
+struct Route {
+    QHostAddress destination;
+    QHostAddress nextHop;    // destination itself or the gateway
+    bool reachable = false;  // false: not in our subnet and no gateway configured
+    bool viaGateway = false;
+};
+
+/*
+Caches the next hop (direct or via gateway) of every configured destination.
+Enumerating network interfaces costs netlink syscalls and allocations, so it is
+done once at startup, then on a timer and (on Linux) when an interface address
+changes, never per datagram.
+*/
+class RouteCache : public QObject {
+    Q_OBJECT
+public:
+    // Default period of the refresh timer
+    static const int DEFAULT_REFRESH_INTERVAL_MS = 60000;
+
+    explicit RouteCache(const QHostAddress &subnetMask, const QHostAddress &gateway,
+                        int refreshIntervalMs = DEFAULT_REFRESH_INTERVAL_MS, QObject *parent = nullptr);
+    ~RouteCache();
+
+    // Period of the refresh timer, 0 disables the timer
+    void setRefreshInterval(int refreshIntervalMs);
+
+    /*
+    Register a destination and resolve its route
+    Return: index for route()
+    */
+    int addDestination(const QHostAddress &destination);
+    // Cached route, no syscalls
+    const Route &route(int index) {
+        ++m_hits;
+        Metrics::add(METRIC_ROUTE_HITS);
+        return m_routes[index];
+    }
+    int destinationCount() const { return m_routes.size(); }
+    // First IPv4 address of the host
+    static QHostAddress findLocalAddress();
+
+    // Number of route() lookups served from the cache
+    quint64 hits() const { return m_hits; }
+    // Number of times the interfaces were enumerated
+    quint64 refreshes() const { return m_refreshes; }
+
+public slots:
+    // Enumerate interfaces and recompute routes of all destinations
+    void refresh();
+
+signals:
+    void errorOccurred(const QString &err);
+
+private:
+    QHostAddress m_subnetMask; // Маска подсети
+    QHostAddress m_gateway;    // Шлюз по умолчанию
+    QVector<Route> m_routes;
+    QHostAddress m_localAddress;
+    QTimer m_refreshTimer;
+    QSocketNotifier *m_netlinkNotifier = nullptr;
+    int m_netlinkSocket = -1;
+    quint64 m_hits = 0;
+    quint64 m_refreshes = 0;
+
+    // Проверка, находится ли адрес в той же подсети
+    bool isInSameSubnet(const QHostAddress &address) const;
+    void resolve(Route &route);
+    // Subscribe to interface address changes (Linux only)
+    void watchNetworkChanges();
+    void readNetlink();
+};
+
+#endif // ROUTECACHE_H
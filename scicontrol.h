@@ -0,0 +1,90 @@
+#ifndef SCICONTROL_H
+#define SCICONTROL_H
+
+#include <cstdint>
+#include "sciprotocol.h"
+#include "snmpoids.h"
+
+// Reply of a unit to a control command
+const uint8_t SCI_CMD_ACK = 0xE;
+const uint8_t SCI_CMD_NACK = 0xF;
+// Default command nibble of control frames ([Poll] controlCmd)
+const uint8_t SCI_CONTROL_CMD = 0x1;
+
+/*
+Writable unit parameter.
+SNMP SET of its unitquery object is sent to the unit as
+"<controlCmd> FF <subCommand> <value, valueBytes big-endian>" and answered with
+ACK or NACK. After an ACK the readback sub-command is queried at once, so the
+stored value is the one the unit reports, not the one that was requested
+*/
+struct SciControl {
+    UnitParam param;
+    uint8_t subCommand;
+    uint8_t valueBytes;
+    int32_t minValue;
+    int32_t maxValue;
+    uint8_t priority;   // Higher goes to the bus first
+    uint8_t readback;   // Status sub-command (0x8) that reports the value
+    const char *name;
+};
+
+/*
+Every writable parameter, one line each; OIDs of the other objects answer
+notWritable. Index in this table identifies the control in the write queue
+*/
+inline constexpr SciControl SCI_CONTROLS[] = {
+    // param  subCommand  valueBytes  minValue  maxValue  priority  readback  name
+    {PARAM_MUTE, 0x0A, 1, 0, 1, 2, 0x09, "Mute"},
+    {PARAM_GAIN, 0x0B, 2, 0, 0xFFFF, 1, 0x09, "Gain"},
+    {PARAM_OPERATING_IF, 0x17, 2, 0, 0xFFFF, 0, 0x17, "Operating IF"},
+};
+const int SCI_CONTROL_COUNT = sizeof(SCI_CONTROLS) / sizeof(SCI_CONTROLS[0]);
+
+// Outcome of a control command
+enum class SciControlResult {
+    Ack,
+    Nack,     // Unit refused the value
+    Timeout,  // No ACK/NACK after all retries
+    Rejected  // Not sent: no bus master polls the unit, queue full or port stopped
+};
+
+/*
+Control behind a writable OID, unit is set to 0-2 (A-C)
+Return: index in SCI_CONTROLS, -1 if the OID cannot be set
+*/
+inline int sciFindControl(const SnmpOid &oid, int &unit) {
+    for (unit = 0; unit < SCI_UNIT_COUNT; ++unit) {
+        for (int i = 0; i < SCI_CONTROL_COUNT; ++i) {
+            if (snmpOidCompare(oid, UNIT_OIDS.oid[unit][SCI_CONTROLS[i].param]) == 0) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+/*
+Build the control frame for value (within minValue..maxValue) into out
+Return: frame size
+*/
+inline int sciEncodeControl(uint8_t destSrc, uint8_t cmd, const SciControl &control, int32_t value, uint8_t *out) {
+    uint8_t data[2 + 4] = {0xFF, control.subCommand};
+    for (int i = 0; i < control.valueBytes; ++i) {
+        data[2 + i] = static_cast<uint8_t>(value >> (8 * (control.valueBytes - 1 - i)));
+    }
+    return sciEncode(destSrc, cmd, data, 2 + control.valueBytes, out);
+}
+
+/*
+Receiver of control commands (Gateway): routes them to the bus master of the unit.
+May be called from any thread; the result comes back as a commandFinished signal
+Return: false if the command was not queued
+*/
+class SciCommandTarget {
+public:
+    virtual ~SciCommandTarget() = default;
+    virtual bool submitCommand(uint8_t address, int control, int32_t value, uint64_t token) = 0;
+};
+
+#endif // SCICONTROL_H
@@ -0,0 +1,80 @@
+#include "sciframereassembler.h"
+
+SciFrameReassembler::SciFrameReassembler() {
+}
+
+int SciFrameReassembler::feed(const uint8_t *data, int size) {
+    int accepted = 0;
+    while (accepted < size && m_count < BUFFER_SIZE) {
+        // Copy up to the physical end of the ring in one go
+        int tail = (m_head + m_count) & BUFFER_MASK;
+        int chunk = BUFFER_SIZE - tail;
+        if (chunk > BUFFER_SIZE - m_count) chunk = BUFFER_SIZE - m_count;
+        if (chunk > size - accepted) chunk = size - accepted;
+        for (int i = 0; i < chunk; ++i) {
+            m_buffer[tail + i] = data[accepted + i];
+        }
+        m_count += chunk;
+        accepted += chunk;
+    }
+    return accepted;
+}
+
+bool SciFrameReassembler::nextFrame(uint8_t *frame, int &frameSize) {
+    while (m_count > 0) {
+        // Resynchronise: everything before STX is garbage
+        if (at(0) != STX) {
+            drop(1);
+            ++m_discardedBytes;
+            continue;
+        }
+        if (m_count < 3) {
+            return false; // Wait for Dest/Src and Cmd/Len bytes
+        }
+
+        int size = (at(2) & 0x0F) + SCI_FRAME_OVERHEAD;
+        if (m_count < size) {
+            return false; // Partial frame, keep it until the next chunk
+        }
+        if (at(size - 1) != ETX) {
+            // STX was a data byte or the frame is broken: skip it and search for the next STX
+            drop(1);
+            ++m_discardedBytes;
+            continue;
+        }
+        if (at(size - 2) != crc(size)) {
+            // STX and ETX in noise at the right distance: resynchronise from the next byte
+            drop(1);
+            ++m_discardedBytes;
+            ++m_crcMismatches;
+            continue;
+        }
+
+        for (int i = 0; i < size; ++i) {
+            frame[i] = at(i);
+        }
+        frameSize = size;
+        drop(size);
+        ++m_framesExtracted;
+        return true;
+    }
+    return false;
+}
+
+void SciFrameReassembler::reset() {
+    m_head = 0;
+    m_count = 0;
+}
+
+uint8_t SciFrameReassembler::crc(int size) const {
+    uint8_t crc = 0;
+    for (int i = 1; i < size - 2; ++i) { // Skip STX, CRC and ETX
+        crc ^= at(i);
+    }
+    return ~crc;
+}
+
+void SciFrameReassembler::drop(int count) {
+    m_head = (m_head + count) & BUFFER_MASK;
+    m_count -= count;
+}
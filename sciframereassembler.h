@@ -0,0 +1,66 @@
+#ifndef SCIFRAMEREASSEMBLER_H
+#define SCIFRAMEREASSEMBLER_H
+
+#include <cstdint>
+#include "sciprotocol.h"
+
+/*
+Incremental SCI frame parser.
+Serial driver delivers arbitrary chunks: a frame may be split between two readyRead events
+or several frames may arrive in one chunk. Bytes are accumulated in a fixed ring buffer,
+the parser resynchronises on STX and pulls out every complete frame (STX ... ETX with
+matching length and CRC). Partial frames stay in the buffer until the next chunk.
+No heap allocations: buffer and output frame are fixed-size.
+The CRC is checked before a frame is taken out: a 0x7E in line noise followed by a
+0x7F at the right distance is not a frame, and accepting it would swallow the start
+of the real frame behind it.
+*/
+class SciFrameReassembler {
+public:
+    // Ring buffer size, power of two; always holds at least one full frame plus a read chunk
+    static const int BUFFER_SIZE = 256;
+
+    SciFrameReassembler();
+
+    /*
+    Append received bytes to the ring buffer
+    Return: number of bytes accepted (less than size if the buffer is full;
+    extract frames with nextFrame() and feed the rest)
+    */
+    int feed(const uint8_t *data, int size);
+    /*
+    Extract the next complete frame into frame (at least SCI_MAX_FRAME_SIZE bytes)
+    Return: true if a frame was extracted, frameSize holds its length
+    */
+    bool nextFrame(uint8_t *frame, int &frameSize);
+    // Drop buffered bytes (e.g. after reopening the port); counters are kept
+    void reset();
+
+    // Number of bytes currently waiting for the rest of a frame
+    int pendingBytes() const { return m_count; }
+    // Bytes thrown away while resynchronising on STX
+    uint64_t discardedBytes() const { return m_discardedBytes; }
+    // STX ... ETX candidates rejected for their CRC (counted in discardedBytes() too)
+    uint64_t crcMismatches() const { return m_crcMismatches; }
+    // Complete frames extracted so far
+    uint64_t framesExtracted() const { return m_framesExtracted; }
+
+private:
+    static const int BUFFER_MASK = BUFFER_SIZE - 1;
+    static_assert((BUFFER_SIZE & BUFFER_MASK) == 0, "BUFFER_SIZE must be a power of two");
+    static_assert(BUFFER_SIZE >= 2 * SCI_MAX_FRAME_SIZE, "BUFFER_SIZE is too small for a frame");
+
+    uint8_t m_buffer[BUFFER_SIZE];
+    int m_head = 0;  // Index of the oldest buffered byte
+    int m_count = 0; // Number of buffered bytes
+    uint64_t m_discardedBytes = 0;
+    uint64_t m_framesExtracted = 0;
+    uint64_t m_crcMismatches = 0;
+
+    uint8_t at(int offset) const { return m_buffer[(m_head + offset) & BUFFER_MASK]; }
+    void drop(int count);
+    // sciCrc() of the buffered frame of size bytes, read in place
+    uint8_t crc(int size) const;
+};
+
+#endif // SCIFRAMEREASSEMBLER_H
@@ -0,0 +1,183 @@
+#include "scihandlers.h"
+#include <QtGlobal>
+#include "log.h"
+
+// Callers check minLength before a handler runs: data[0..minLength-1] is always there
+
+void sciUpdatePaStatus(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Mute Status
+    int32_t mute = static_cast<int32_t>(pack.data[2]);
+    out.addVarbind(source.oids[PARAM_MUTE], SnmpValue::integer(mute));
+
+    // Summary Alarm
+    int32_t summaryAlarm = (pack.data[3] & 0x80) ? 1 : 0;
+    out.addAlarmVarbind(source.oids[PARAM_SUMMARY_ALARM], SnmpValue::integer(summaryAlarm), source.src);
+
+    // Temperature Alarm
+    int32_t tempAlarm = (pack.data[4] & 0x04) ? 1 : 0;
+    out.addAlarmVarbind(source.oids[PARAM_TEMP_ALARM], SnmpValue::integer(tempAlarm), source.src);
+
+    // Temperature
+    int16_t tempRaw = static_cast<int16_t>((pack.data[5] << 8) | pack.data[6]);
+    int32_t temp = static_cast<int32_t>(tempRaw);
+    out.addVarbind(source.oids[PARAM_TEMPERATURE], SnmpValue::integer(temp));
+
+    // Gain
+    uint16_t gainRaw = (static_cast<uint8_t>(pack.data[7]) << 8) | static_cast<uint8_t>(pack.data[8]);
+    int32_t gain = static_cast<int32_t>(gainRaw);
+    out.addVarbind(source.oids[PARAM_GAIN], SnmpValue::integer(gain));
+
+    // Output Power
+    uint16_t powerRaw = (static_cast<uint8_t>(pack.data[9]) << 8) | static_cast<uint8_t>(pack.data[10]);
+    int32_t power = static_cast<int32_t>(powerRaw);
+    out.addVarbind(source.oids[PARAM_POWER], SnmpValue::integer(power));
+}
+
+void sciUpdateSwVersion(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: base.base.base.base-config.config-revision ("01.02.03.04-05.06-AB")
+    char fullVersion[32];
+    int fullVersionLength = qsnprintf(fullVersion, sizeof(fullVersion), "%02x.%02x.%02x.%02x-%02x.%02x-%c%c",
+                                      pack.data[2], pack.data[3], pack.data[4], pack.data[5],
+                                      pack.data[6], pack.data[7], pack.data[8], pack.data[9]);
+
+    // Отправляем в product.version (1.3.6.1.4.1.58039.1.2)
+    out.addVarbind(OID_PRODUCT_VERSION, SnmpValue::octetString(fullVersion, fullVersionLength));
+    // info.4-6 (paAVer / paBVer / paCVer)
+    out.addVarbind(PA_FIRMWARE_OIDS[source.unit], SnmpValue::octetString(fullVersion, fullVersionLength));
+}
+
+void sciUpdateFrequencyBand(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    int32_t freqBand = pack.data[2];
+    out.addVarbind(source.oids[PARAM_OPERATING_IF], SnmpValue::integer(freqBand == 0 ? 13050 : 12800)); // LO freq
+}
+
+void sciUpdateFrequencySetting(const SCIPacket &pack, const SciSource &source, SciOutput &) {
+    // Nothing in MIB, visible in the log only
+    LOG_DEBUG(LOG_SCI, "Src {} frequency setting: {}", source.src, logHex(pack.data + 2, pack.len - 2));
+}
+
+void sciUpdateAlarmLog(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: FF 05 EE XX YY UU - event id, alarm code, logging unit
+    uint8_t eventId = pack.data[2];
+    if (eventId < 0x11 || eventId > 0x15) {
+        return;
+    }
+    uint8_t logUnit = pack.data[5];
+    char alarmLog[32];
+    int alarmLogLength;
+    if (logUnit == 0x01) { // PA
+        alarmLogLength = qsnprintf(alarmLog, sizeof(alarmLog), "PA %c: %02x%02x",
+                                   'A' + source.unit, pack.data[3], pack.data[4]);
+    } else if (logUnit == 0x04) { // Switches
+        alarmLogLength = qsnprintf(alarmLog, sizeof(alarmLog), "Switches: %02x%02x",
+                                   pack.data[3], pack.data[4]);
+    } else {
+        return;
+    }
+
+    // Determining which alarm log to write to (1, 2, or 3)
+    int logIndex = eventId - 0x11; // 0x11 -> log1, 0x12 -> log2, 0x13 -> log3
+    if (logIndex < 3) {
+        const SnmpOid &alarmLogOid = (logUnit == 0x01) ? source.oids[PARAM_ALARM_LOG1 + logIndex] // PA
+                                                       : SWITCH_ALARM_LOG_OIDS[logIndex];         // switchAlarmLog1-3
+        out.addAlarmVarbind(alarmLogOid, SnmpValue::octetString(alarmLog, alarmLogLength), source.src);
+    }
+}
+
+void sciUpdateRedundantStatus(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: FF 08 00 WW 00 YY
+    uint8_t systemStatus = pack.data[3];
+    uint8_t switchStatus = pack.data[4];
+
+    // System Type (info.unitType, 1.3.6.1.4.1.58039.2.1)
+    int32_t systemType = (systemStatus & 0x01) ? 3 : 0; // Bit 0: 0=1:1, 1=1:2
+    if (systemStatus & 0x80) systemType = 1; // Bit 7: 1=standalone
+    out.addVarbind(OID_UNIT_TYPE, SnmpValue::integer(systemType));
+
+    // Operation Mode (info.opMode, 1.3.6.1.4.1.58039.2.2)
+    int32_t opMode = (systemStatus & 0x02) ? 1 : 0; // Bit 1: 0=auto, 1=manual
+    out.addVarbind(OID_OP_MODE, SnmpValue::integer(opMode));
+
+    // Switch Position (config.uplinkChain, 1.3.6.1.4.1.58039.3.6)
+    int32_t switchPos = (switchStatus == 0x01) ? 0 : (switchStatus == 0x02) ? 1 : 2; // 01=side A, 02=side B, else=standalone
+    out.addVarbind(OID_UPLINK_CHAIN, SnmpValue::integer(switchPos));
+
+    // PA Status (unitquery.pAAStatus/pABStatus/pACStatus)
+    int32_t paStatus = (switchStatus == 0x01) ? 0 : 1; // 01=side A (active), else=standby
+    out.addVarbind(source.oids[PARAM_STATUS], SnmpValue::integer(paStatus));
+}
+
+void sciUpdateSystemAlarms(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: FF 0C VV WW 00 YY
+    uint8_t systemAlarm1 = pack.data[2]; // VV
+    uint8_t systemAlarm2 = pack.data[3]; // WW
+    uint8_t switchAlarm = pack.data[4];  // YY
+
+    // Uplink Switch Alarms (unitquery.upSwitchAlarm, 1.3.6.1.4.1.58039.4.60)
+    int32_t switch1Alarm = 0;
+    if (switchAlarm & 0x01) switch1Alarm = 2; // out of position
+    else if (switchAlarm & 0x04) switch1Alarm = 3; // unable to move
+    else if (systemAlarm1 & 0x01) switch1Alarm = 1; // communication alarm
+    out.addAlarmVarbind(OID_UP_SWITCH_ALARM, SnmpValue::integer(switch1Alarm), source.src);
+
+    // Uplink Switch 2 Alarms (unitquery.upSwitch2Alarm, 1.3.6.1.4.1.58039.4.61)
+    int32_t switch2Alarm = 0;
+    if (switchAlarm & 0x08) switch2Alarm = 2; // out of position
+    else if (switchAlarm & 0x20) switch2Alarm = 3; // unable to move
+    else if (systemAlarm1 & 0x02) switch2Alarm = 1; // communication alarm
+    out.addAlarmVarbind(OID_UP_SWITCH2_ALARM, SnmpValue::integer(switch2Alarm), source.src);
+
+    // PA Summary Alarms: bit 0 - unit A, bit 1 - unit B, bit 2 - unit C
+    int32_t summaryAlarm = (systemAlarm2 & (1 << source.unit)) ? 1 : 0;
+    out.addAlarmVarbind(source.oids[PARAM_SUMMARY_ALARM], SnmpValue::integer(summaryAlarm), source.src);
+}
+
+void sciUpdateLoFrequency(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Update LO Frequency and Tx Freq Band или Update IF Frequency
+    if (pack.data[2] == 0x17 && pack.len >= 5) { // LO Frequency and Tx Freq Band
+        // Format: FF 17 L1 L2 M1 M2 M3 M4
+        uint16_t loFreq = (pack.data[3] << 8) | pack.data[4];
+        // Saving only LO Frequency in operatingIF
+        out.addVarbind(source.oids[PARAM_OPERATING_IF], SnmpValue::integer(loFreq));
+    } else if (pack.data[2] == 0xFF && pack.data[3] == 0x17 && pack.len >= 6) { // IF Frequency
+        // Format: FF 17 FF YY YY
+        uint16_t ifFreq = (pack.data[4] << 8) | pack.data[5];
+        out.addVarbind(source.oids[PARAM_OPERATING_IF], SnmpValue::integer(ifFreq));
+    }
+}
+
+void sciUpdateOutputFrequency(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: FF 18 YY YY
+    uint16_t txFreq = (pack.data[2] << 8) | pack.data[3];
+    out.addVarbind(source.oids[PARAM_OPERATING_IF], SnmpValue::integer(txFreq));
+}
+
+void sciUpdateInputVoltage(const SCIPacket &pack, const SciSource &source, SciOutput &out) {
+    // Format: FF 19 VV VV
+    uint16_t voltage = (pack.data[2] << 8) | pack.data[3];
+    out.addVarbind(source.oids[PARAM_INPUT_VOLTAGE], SnmpValue::integer(voltage));
+}
+
+void sciUpdateMacAddress(const SCIPacket &pack, const SciSource &source, SciOutput &) {
+    // Format: FF 20 M1 M2 M3 M4 M5 M6; nothing in MIB, visible in the log only
+    LOG_DEBUG(LOG_SCI, "Src {} MAC address: {}", source.src, logHex(pack.data + 2, 6));
+}
+
+void sciUpdateHostName(const SCIPacket &pack, const SciSource &, SciOutput &out) {
+    // Format: FF 21 Y1 Y2 Y3 Y4 Y5 Y6 Y7 Y8 Y9 Y10 Y11
+    // We are sending to product.name (1.3.6.1.4.1.58039.1.1)
+    out.addVarbind(OID_PRODUCT_NAME, SnmpValue::octetString(reinterpret_cast<const char*>(&pack.data[2]), 11));
+}
+
+void sciUpdateDhcpConfig(const SCIPacket &pack, const SciSource &source, SciOutput &) {
+    // Nothing in MIB, visible in the log only
+    LOG_DEBUG(LOG_SCI, "Src {} DHCP configuration: {}", source.src, logHex(pack.data + 2, pack.len - 2));
+}
+
+void sciCommandAck(const SCIPacket &pack, const SciSource &source, SciOutput &) {
+    LOG_DEBUG(LOG_SCI, "Src {} ACK {}", source.src, logHex(pack.data, pack.len));
+}
+
+void sciCommandNack(const SCIPacket &pack, const SciSource &source, SciOutput &) {
+    LOG_DEBUG(LOG_SCI, "Src {} NACK {}", source.src, logHex(pack.data, pack.len));
+}
@@ -0,0 +1,128 @@
+#ifndef SCIHANDLERS_H
+#define SCIHANDLERS_H
+
+#include <cstdint>
+#include "sciprotocol.h"
+#include "snmpoids.h"
+#include "snmpvalue.h"
+
+// Receiver of the objects decoded from one SCI frame (SnmpConverter, benchmarks)
+class SciOutput {
+public:
+    virtual ~SciOutput() = default;
+    virtual void addVarbind(const SnmpOid &oid, const SnmpValue &value) = 0;
+    // Alarm object: a changed value also goes out as a notification
+    virtual void addAlarmVarbind(const SnmpOid &oid, const SnmpValue &value, uint8_t src) = 0;
+};
+
+// Unit that sent the frame
+struct SciSource {
+    uint8_t src;         // Address nibble of Dest/Src
+    int unit;            // sciUnitIndex(src), never -1 here
+    const SnmpOid *oids; // UNIT_OIDS.oid[unit], indexed by UnitParam
+};
+
+// Decode the payload of one (cmd, subCommand) into varbinds
+typedef void (*SciHandler)(const SCIPacket &pack, const SciSource &source, SciOutput &out);
+
+/*
+Subcommand keys of the dispatch table.
+Status frames carry "FF <subCommand>" in front of the data (0x00-0xFF); frames
+without that prefix (ACK, NACK, ...) use SCI_NO_SUBCOMMAND.
+A handler registered with SCI_ANY_SUBCOMMAND gets every frame of its cmd
+*/
+const int SCI_NO_SUBCOMMAND = 0x100;
+const int SCI_SUBCOMMAND_KEYS = 0x101;
+const int SCI_ANY_SUBCOMMAND = -1;
+const int SCI_COMMAND_COUNT = 16; // cmd is the high nibble of Cmd/Len
+
+struct SciCommandHandler {
+    uint8_t cmd;
+    int subCommand;
+    uint8_t minLength;   // Payload bytes (FF and subCommand included) the handler reads, shorter frames are dropped
+    uint8_t maxVarbinds; // Varbinds one frame may add
+    const char *name;
+    SciHandler handle;
+};
+
+// Status frames (cmd 0x8), section of the SCI specification in brackets
+void sciUpdatePaStatus(const SCIPacket &pack, const SciSource &source, SciOutput &out);       // 0x09 (7.1)
+void sciUpdateSwVersion(const SCIPacket &pack, const SciSource &source, SciOutput &out);      // 0x00 (7.3)
+void sciUpdateFrequencyBand(const SCIPacket &pack, const SciSource &source, SciOutput &out);  // 0x03 (7.3)
+void sciUpdateFrequencySetting(const SCIPacket &pack, const SciSource &source, SciOutput &out); // 0x04 (7.3)
+void sciUpdateAlarmLog(const SCIPacket &pack, const SciSource &source, SciOutput &out);       // 0x05 (7.1)
+void sciUpdateRedundantStatus(const SCIPacket &pack, const SciSource &source, SciOutput &out); // 0x06 (9.1)
+void sciUpdateSystemAlarms(const SCIPacket &pack, const SciSource &source, SciOutput &out);   // 0x0C (9.1)
+void sciUpdateLoFrequency(const SCIPacket &pack, const SciSource &source, SciOutput &out);    // 0x17 (7.3)
+void sciUpdateOutputFrequency(const SCIPacket &pack, const SciSource &source, SciOutput &out); // 0x18 (7.3)
+void sciUpdateInputVoltage(const SCIPacket &pack, const SciSource &source, SciOutput &out);   // 0x19 (7.3)
+void sciUpdateMacAddress(const SCIPacket &pack, const SciSource &source, SciOutput &out);     // 0x20 (8.1)
+void sciUpdateHostName(const SCIPacket &pack, const SciSource &source, SciOutput &out);       // 0x21 (8.1)
+void sciUpdateDhcpConfig(const SCIPacket &pack, const SciSource &source, SciOutput &out);     // 0x31 (8.1)
+// Replies to control commands; the bus master matches them to its command, here they are only logged
+void sciCommandAck(const SCIPacket &pack, const SciSource &source, SciOutput &out);
+void sciCommandNack(const SCIPacket &pack, const SciSource &source, SciOutput &out);
+
+/*
+Every decoded (cmd, subCommand). A new subcommand is one handler function and
+one line here; frames without an entry are ignored (nothing in MIB).
+At most 255 entries, a key may be claimed only once
+*/
+inline constexpr SciCommandHandler SCI_HANDLERS[] = {
+    // cmd  subCommand  minLength  maxVarbinds  name
+    {0x8, 0x09, 11, 6, "UPD", sciUpdatePaStatus},
+    {0x8, 0x00, 10, 2, "SW version", sciUpdateSwVersion},
+    {0x8, 0x03, 3, 1, "Frequency band", sciUpdateFrequencyBand},
+    {0x8, 0x04, 2, 0, "Frequency setting", sciUpdateFrequencySetting},
+    {0x8, 0x05, 6, 1, "Alarm log", sciUpdateAlarmLog},
+    {0x8, 0x06, 5, 4, "Redundant system status", sciUpdateRedundantStatus},
+    {0x8, 0x0C, 5, 3, "System and switch alarms", sciUpdateSystemAlarms},
+    {0x8, 0x17, 4, 1, "LO/IF frequency", sciUpdateLoFrequency},
+    {0x8, 0x18, 4, 1, "Output frequency", sciUpdateOutputFrequency},
+    {0x8, 0x19, 4, 1, "Input DC voltage", sciUpdateInputVoltage},
+    {0x8, 0x20, 8, 0, "MAC address", sciUpdateMacAddress},
+    {0x8, 0x21, 13, 1, "Host name", sciUpdateHostName},
+    {0x8, 0x31, 3, 0, "DHCP configuration", sciUpdateDhcpConfig},
+    {0xE, SCI_ANY_SUBCOMMAND, 0, 0, "ACK", sciCommandAck},
+    {0xF, SCI_ANY_SUBCOMMAND, 0, 0, "NACK", sciCommandNack},
+};
+const int SCI_HANDLER_COUNT = sizeof(SCI_HANDLERS) / sizeof(SCI_HANDLERS[0]);
+
+// 1 + index in SCI_HANDLERS for [cmd][subCommand key], 0 - no handler
+struct SciDispatchTable {
+    uint8_t handler[SCI_COMMAND_COUNT][SCI_SUBCOMMAND_KEYS];
+    bool valid; // false: two entries claim the same key or there are too many entries
+};
+
+constexpr SciDispatchTable buildSciDispatchTable() {
+    SciDispatchTable table{};
+    table.valid = SCI_HANDLER_COUNT < 256;
+    for (int i = 0; i < SCI_HANDLER_COUNT; ++i) {
+        const SciCommandHandler &entry = SCI_HANDLERS[i];
+        for (int key = 0; key < SCI_SUBCOMMAND_KEYS; ++key) {
+            if (entry.subCommand != SCI_ANY_SUBCOMMAND && entry.subCommand != key) {
+                continue;
+            }
+            if (table.handler[entry.cmd][key] != 0) {
+                table.valid = false;
+            }
+            table.handler[entry.cmd][key] = static_cast<uint8_t>(i + 1);
+        }
+    }
+    return table;
+}
+
+inline constexpr SciDispatchTable SCI_DISPATCH = buildSciDispatchTable();
+static_assert(SCI_DISPATCH.valid, "SCI_HANDLERS: duplicate (cmd, subCommand) or more than 255 entries");
+
+/*
+Handler of a decoded frame: one table lookup, no per-command branches
+Return: nullptr when nothing in MIB comes from the frame
+*/
+inline const SciCommandHandler *sciFindHandler(const SCIPacket &pack) {
+    int key = (pack.len >= 2 && pack.data[0] == 0xFF) ? pack.data[1] : SCI_NO_SUBCOMMAND;
+    uint8_t index = SCI_DISPATCH.handler[pack.cmd & 0x0F][key];
+    return index ? &SCI_HANDLERS[index - 1] : nullptr;
+}
+
+#endif // SCIHANDLERS_H
@@ -0,0 +1,109 @@
+#ifndef SCIPROTOCOL_H
+#define SCIPROTOCOL_H
+
+#include <cstdint>
+
+// Константы для SCI-пакетов
+const uint8_t STX = 0x7E; // start byte
+const uint8_t ETX = 0x7F; // end byte
+
+/*
+SCI frame layout:
+>STX | Dest/Src | Cmd/Len | Data[len] | CRC | ETX
+Length lives in the low nibble of Cmd/Len, so a frame is never longer than 15 + 5 bytes
+*/
+const int SCI_FRAME_OVERHEAD = 5;
+const int SCI_MAX_DATA_LENGTH = 0x0F;
+const int SCI_MAX_FRAME_SIZE = SCI_MAX_DATA_LENGTH + SCI_FRAME_OVERHEAD;
+
+// Result of SCI frame validation
+enum class SciStatus {
+    Ok,
+    TooShort,      // Less than SCI_FRAME_OVERHEAD bytes
+    BadDelimiters, // No STX at the start or no ETX at the end
+    BadLength,     // Frame size does not match the length nibble
+    BadCrc         // CRC byte does not match
+};
+const int SCI_STATUS_COUNT = 5;
+
+inline const char *sciStatusName(SciStatus status) {
+    switch (status) {
+    case SciStatus::Ok: return "Ok";
+    case SciStatus::TooShort: return "SCI packet too short";
+    case SciStatus::BadDelimiters: return "Invalid STX/ETX";
+    case SciStatus::BadLength: return "Invalid data length";
+    case SciStatus::BadCrc: return "CRC mismatch";
+    }
+    return "Unknown";
+}
+
+/*
+Структура SCI-пакета: view over a received frame, nothing is copied.
+data points at the payload inside the frame buffer and is valid as long as that buffer is
+*/
+struct SCIPacket {
+    uint8_t destSrc = 0;          // Байт Dest/Src
+    uint8_t cmd = 0;              // Команда (извлекается из cmdLen)
+    uint8_t len = 0;              // Длина данных (извлекается из cmdLen)
+    const uint8_t *data = nullptr; // Данные пакета (len bytes)
+    uint8_t crc = 0;              // CRC
+};
+
+// CRC of a whole frame: inverted XOR of everything between STX and the CRC byte
+inline uint8_t sciCrc(const uint8_t *frame, int size) {
+    uint8_t crc = 0;
+    for (int i = 1; i < size - 2; ++i) { // Skip STX, CRC and ETX
+        crc ^= frame[i];
+    }
+    return ~crc;
+}
+
+/*
+Validate a frame (STX ... ETX) and fill the view, no exceptions and no allocations
+Return: SciStatus::Ok if packet is filled
+*/
+inline SciStatus sciDecode(const uint8_t *frame, int size, SCIPacket &packet) {
+    if (size < SCI_FRAME_OVERHEAD) {
+        return SciStatus::TooShort;
+    }
+    if (frame[0] != STX || frame[size - 1] != ETX) {
+        return SciStatus::BadDelimiters;
+    }
+    uint8_t len = frame[2] & 0x0F; // low nibble of the byte - length of data
+    if (size != len + SCI_FRAME_OVERHEAD) {
+        return SciStatus::BadLength;
+    }
+    uint8_t crc = frame[size - 2];
+    if (sciCrc(frame, size) != crc) {
+        return SciStatus::BadCrc;
+    }
+
+    packet.destSrc = frame[1];           // high nibble is destination; low nibble is source
+    packet.cmd = (frame[2] >> 4) & 0x0F; // high nibble of the byte - command
+    packet.len = len;
+    packet.data = frame + 3;             // skip STX, destSrc and CmdLen bytes
+    packet.crc = crc;
+    return SciStatus::Ok;
+}
+
+/*
+Build a frame (STX ... ETX) into out, which holds at least len + SCI_FRAME_OVERHEAD bytes
+Return: frame size, 0 if len is more than SCI_MAX_DATA_LENGTH
+*/
+inline int sciEncode(uint8_t destSrc, uint8_t cmd, const uint8_t *data, int len, uint8_t *out) {
+    if (len < 0 || len > SCI_MAX_DATA_LENGTH) {
+        return 0;
+    }
+    int size = len + SCI_FRAME_OVERHEAD;
+    out[0] = STX;
+    out[1] = destSrc;
+    out[2] = static_cast<uint8_t>(((cmd & 0x0F) << 4) | len);
+    for (int i = 0; i < len; ++i) {
+        out[3 + i] = data[i];
+    }
+    out[size - 1] = ETX;
+    out[size - 2] = sciCrc(out, size);
+    return size;
+}
+
+#endif // SCIPROTOCOL_H
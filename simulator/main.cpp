@@ -0,0 +1,165 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <vector>
+#include "virtualbus.h"
+
+/*
+Virtual RS485 buses for load tests without PA hardware.
+Every bus is a pseudo-terminal; point [SerialPort] portName (or [SerialPort.N])
+at the printed slave path or at --link, and the converter reads it like a
+real adapter. Offered load grows with --buses, --pa, --switches and --rate,
+the wire limit with --baud; watch the converter's [Metrics] endpoint for
+its saturation point and tail latency.
+*/
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void onSignal(int) {
+    g_stop = 1;
+}
+
+int64_t monotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+// PA addresses the converter decodes first, then the rest of the bus
+const uint8_t PA_ADDRESSES[] = {0xA, 0xB, 0xC, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xD, 0xE, 0xF};
+const int PA_ADDRESS_COUNT = sizeof(PA_ADDRESSES);
+
+// Poll period of the buses
+const int64_t TICK_NS = 1000000;
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Virtual RS485 buses with simulated PA and switch units (pseudo-terminals)");
+    parser.addHelpOption();
+    QCommandLineOption busesOption("buses", "Number of buses (pseudo-terminals).", "n", "1");
+    QCommandLineOption paOption("pa", "PA units per bus (addresses A, B, C, then 1-9, D-F).", "n", "3");
+    QCommandLineOption switchesOption("switches", "Switch units per bus (0x06/0x0C frames).", "n", "1");
+    QCommandLineOption switchAddressOption("switch-address", "Source address of the switch frames (hex).", "address", "A");
+    QCommandLineOption rateOption("rate", "Frames per second of every unit, 0 - only answer bus master queries.", "fps", "10");
+    QCommandLineOption baudOption("baud", "Wire speed of every bus, 0 - unlimited.", "baud", "19200");
+    QCommandLineOption corruptOption("corrupt", "Probability of a damaged frame (bad CRC, lost ETX, cut short).", "p", "0");
+    QCommandLineOption garbageOption("garbage", "Probability of noise bytes before a frame.", "p", "0");
+    QCommandLineOption burstIntervalOption("burst-interval", "Seconds between bursts, 0 - no bursts.", "sec", "0");
+    QCommandLineOption burstFramesOption("burst-frames", "Extra frames every unit sends in a burst.", "n", "20");
+    QCommandLineOption linkOption("link", "Symlink to the slave of bus 0 (bus N gets <path>.N).", "path");
+    QCommandLineOption durationOption("duration", "Stop after this many seconds, 0 - until Ctrl+C.", "sec", "0");
+    QCommandLineOption statsOption("stats-interval", "Seconds between statistics lines.", "sec", "1");
+    QCommandLineOption seedOption("seed", "Seed of the simulated values.", "n", "1");
+    for (const QCommandLineOption &option : {busesOption, paOption, switchesOption, switchAddressOption, rateOption, baudOption,
+                                              corruptOption, garbageOption, burstIntervalOption, burstFramesOption, linkOption,
+                                              durationOption, statsOption, seedOption}) {
+        parser.addOption(option);
+    }
+    parser.process(a);
+
+    BusOptions options;
+    options.baudRate = parser.value(baudOption).toInt();
+    options.framesPerSecond = parser.value(rateOption).toDouble();
+    options.corruptProbability = parser.value(corruptOption).toDouble();
+    options.garbageProbability = parser.value(garbageOption).toDouble();
+    options.burstIntervalSec = parser.value(burstIntervalOption).toDouble();
+    options.burstFrames = parser.value(burstFramesOption).toInt();
+    int busCount = qMax(1, parser.value(busesOption).toInt());
+    int paCount = qMax(0, parser.value(paOption).toInt());
+    int switchCount = qMax(0, parser.value(switchesOption).toInt());
+    uint8_t switchAddress = static_cast<uint8_t>(parser.value(switchAddressOption).toUInt(nullptr, 16) & 0x0F);
+    double duration = parser.value(durationOption).toDouble();
+    double statsInterval = qMax(0.1, parser.value(statsOption).toDouble());
+    uint32_t seed = parser.value(seedOption).toUInt();
+    QString link = parser.value(linkOption);
+
+    std::vector<std::unique_ptr<VirtualBus>> buses;
+    for (int i = 0; i < busCount; ++i) {
+        std::unique_ptr<VirtualBus> bus(new VirtualBus(options, seed + static_cast<uint32_t>(i) * 7919u));
+        QString error;
+        QString busLink = link.isEmpty() ? QString() : (i == 0 ? link : QString("%1.%2").arg(link).arg(i));
+        if (!bus->open(busLink, &error)) {
+            fprintf(stderr, "%s\n", qPrintable(error));
+            return 1;
+        }
+        for (int unit = 0; unit < paCount; ++unit) {
+            bus->addUnit(UnitKind::PowerAmplifier, PA_ADDRESSES[unit % PA_ADDRESS_COUNT]);
+        }
+        for (int unit = 0; unit < switchCount; ++unit) {
+            bus->addUnit(UnitKind::Switch, switchAddress);
+        }
+        printf("bus %d: %s%s, %d units, %g frames/s each, %d baud\n", i, qPrintable(bus->slavePath()),
+               busLink.isEmpty() ? "" : qPrintable(" (" + busLink + ")"), bus->unitCount(), options.framesPerSecond,
+               options.baudRate);
+        buses.push_back(std::move(bus));
+    }
+    fflush(stdout);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // Offered wire capacity of all buses, bytes per second
+    double capacity = options.baudRate > 0 ? options.baudRate / 10.0 * busCount : 0;
+    int64_t start = monotonicNs();
+    int64_t nextTick = start;
+    int64_t nextStats = start + static_cast<int64_t>(statsInterval * 1e9);
+    BusStats previous;
+    while (!g_stop) {
+        int64_t now = monotonicNs();
+        if (duration > 0 && now - start >= static_cast<int64_t>(duration * 1e9)) {
+            break;
+        }
+        for (std::unique_ptr<VirtualBus> &bus : buses) {
+            bus->poll(now);
+        }
+
+        if (now >= nextStats) {
+            BusStats total;
+            size_t backlog = 0;
+            for (const std::unique_ptr<VirtualBus> &bus : buses) {
+                const BusStats &stats = bus->stats();
+                total.frames += stats.frames;
+                total.bytesWritten += stats.bytesWritten;
+                total.corrupted += stats.corrupted;
+                total.garbageBytes += stats.garbageBytes;
+                total.overruns += stats.overruns;
+                total.queries += stats.queries;
+                total.nacks += stats.nacks;
+                total.commands += stats.commands;
+                backlog += bus->backlog();
+            }
+            double bytesPerSecond = (total.bytesWritten - previous.bytesWritten) / statsInterval;
+            printf("%7.1fs frames %llu (%.0f/s) bytes %.0f/s", (now - start) / 1e9,
+                   static_cast<unsigned long long>(total.frames), (total.frames - previous.frames) / statsInterval, bytesPerSecond);
+            if (capacity > 0) {
+                printf(" (%.0f%% of wire)", 100.0 * bytesPerSecond / capacity);
+            }
+            printf(" corrupted %llu garbage bytes %llu backlog %zu overruns %llu queries %llu nacks %llu commands %llu\n",
+                   static_cast<unsigned long long>(total.corrupted), static_cast<unsigned long long>(total.garbageBytes),
+                   backlog, static_cast<unsigned long long>(total.overruns), static_cast<unsigned long long>(total.queries),
+                   static_cast<unsigned long long>(total.nacks), static_cast<unsigned long long>(total.commands));
+            fflush(stdout);
+            previous = total;
+            nextStats += static_cast<int64_t>(statsInterval * 1e9);
+        }
+
+        nextTick += TICK_NS;
+        if (nextTick < now) {
+            nextTick = now; // Fell behind: do not try to catch up tick by tick
+        }
+        timespec wake;
+        wake.tv_sec = static_cast<time_t>(nextTick / 1000000000LL);
+        wake.tv_nsec = static_cast<long>(nextTick % 1000000000LL);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr);
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+# Virtual RS485 buses (pseudo-terminals) with simulated PA and switch units:
+#   cd simulator && qmake simulator.pro && make && ./rs485_sim --help
+QT = core
+
+CONFIG += c++17 cmdline
+TARGET = rs485_sim
+
+# posix_openpt / ptsname_r
+!unix: error("rs485_sim needs a Unix pseudo-terminal")
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        main.cpp \
+        virtualbus.cpp \
+        virtualunit.cpp \
+        ../sciframereassembler.cpp
+
+HEADERS += \
+    virtualbus.h \
+    virtualunit.h \
+    ../sciframereassembler.h \
+    ../sciprotocol.h \
+    ../scicontrol.h
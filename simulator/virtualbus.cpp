@@ -0,0 +1,253 @@
+#include "virtualbus.h"
+#include <QFile>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../scicontrol.h"
+
+namespace {
+
+// Frames one unit may send in one poll() after a stall, the rest is skipped
+const int MAX_CATCH_UP_FRAMES = 1000;
+// Longest run of noise bytes before a frame
+const int MAX_GARBAGE_BYTES = 8;
+
+bool chance(VirtualUnit &random, double probability) {
+    return probability > 0 && (random.random() % 1000000) < probability * 1000000;
+}
+
+} // namespace
+
+VirtualBus::VirtualBus(const BusOptions &options, uint32_t seed)
+    : m_options(options), m_noise(UnitKind::PowerAmplifier, 0, seed ^ 0x9E3779B9u) {
+    m_pending.reserve(MAX_BACKLOG_BYTES);
+}
+
+VirtualBus::~VirtualBus() {
+    if (!m_linkPath.isEmpty()) {
+        ::unlink(QFile::encodeName(m_linkPath).constData());
+    }
+    if (m_slave >= 0) {
+        ::close(m_slave);
+    }
+    if (m_master >= 0) {
+        ::close(m_master);
+    }
+}
+
+bool VirtualBus::open(const QString &linkPath, QString *error) {
+    m_master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    char name[128];
+    if (m_master < 0 || ::grantpt(m_master) != 0 || ::unlockpt(m_master) != 0
+        || ::ptsname_r(m_master, name, sizeof(name)) != 0) {
+        *error = QString("Cannot create a pseudo-terminal: ") + strerror(errno);
+        return false;
+    }
+    m_slavePath = QString::fromLocal8Bit(name);
+
+    // Raw mode: no echo, no CR/LF or DEL (0x7F = ETX) translation before the reader sets its own
+    m_slave = ::open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    termios settings;
+    if (m_slave < 0 || ::tcgetattr(m_slave, &settings) != 0) {
+        *error = "Cannot open " + m_slavePath + ": " + strerror(errno);
+        return false;
+    }
+    ::cfmakeraw(&settings);
+    ::tcsetattr(m_slave, TCSANOW, &settings);
+
+    if (!linkPath.isEmpty()) {
+        QByteArray link = QFile::encodeName(linkPath);
+        ::unlink(link.constData());
+        if (::symlink(name, link.constData()) != 0) {
+            *error = "Cannot create link " + linkPath + ": " + strerror(errno);
+            return false;
+        }
+        m_linkPath = linkPath;
+    }
+    return true;
+}
+
+void VirtualBus::addUnit(UnitKind kind, uint8_t address) {
+    uint32_t seed = m_noise.random();
+    m_units.push_back(Unit{VirtualUnit(kind, address, seed), 0});
+}
+
+void VirtualBus::poll(int64_t nowNs) {
+    int64_t interval = m_options.framesPerSecond > 0 ? static_cast<int64_t>(1e9 / m_options.framesPerSecond) : 0;
+    if (m_lastPollNs < 0) {
+        // Spread the units over one period instead of all talking at once
+        for (size_t i = 0; i < m_units.size(); ++i) {
+            m_units[i].nextFrameNs = nowNs + interval * static_cast<int64_t>(i) / static_cast<int64_t>(m_units.size());
+        }
+        m_nextBurstNs = nowNs + static_cast<int64_t>(m_options.burstIntervalSec * 1e9);
+        m_lastPollNs = nowNs;
+    }
+
+    if (interval > 0) {
+        for (Unit &unit : m_units) {
+            int frames = 0;
+            while (unit.nextFrameNs <= nowNs && frames < MAX_CATCH_UP_FRAMES) {
+                emitFrame(unit);
+                unit.nextFrameNs += interval;
+                ++frames;
+            }
+            if (unit.nextFrameNs <= nowNs) {
+                unit.nextFrameNs = nowNs + interval; // Stalled too long: do not flood
+            }
+        }
+    }
+    if (m_options.burstIntervalSec > 0 && m_options.burstFrames > 0 && nowNs >= m_nextBurstNs) {
+        for (Unit &unit : m_units) {
+            for (int i = 0; i < m_options.burstFrames; ++i) {
+                emitFrame(unit);
+            }
+        }
+        m_nextBurstNs += static_cast<int64_t>(m_options.burstIntervalSec * 1e9);
+    }
+
+    writeWire(nowNs);
+
+    // Whatever the reader sends is consumed so the pty never fills up; queries are answered
+    uint8_t input[256];
+    ssize_t size;
+    while ((size = ::read(m_master, input, sizeof(input))) > 0) {
+        int offset = 0;
+        while (offset < size) {
+            offset += m_framer.feed(input + offset, static_cast<int>(size) - offset);
+            uint8_t frame[SCI_MAX_FRAME_SIZE];
+            int frameSize = 0;
+            while (m_framer.nextFrame(frame, frameSize)) {
+                answerQuery(frame, frameSize);
+            }
+        }
+    }
+}
+
+void VirtualBus::answerQuery(const uint8_t *frame, int size) {
+    SCIPacket pack;
+    if (sciDecode(frame, size, pack) != SciStatus::Ok || pack.len < 2 || pack.data[0] != 0xFF) {
+        return;
+    }
+    uint8_t address = pack.destSrc >> 4;
+    uint8_t subCommand = pack.data[1];
+    if (pack.cmd == SCI_CONTROL_CMD) {
+        VirtualUnit *first = nullptr;
+        for (Unit &unit : m_units) {
+            if (unit.unit.address() != address) {
+                continue;
+            }
+            if (!first) {
+                first = &unit.unit;
+            }
+            if (unit.unit.control(subCommand, pack.data + 2, pack.len - 2)) {
+                ++m_stats.commands;
+                uint8_t reply[SCI_MAX_FRAME_SIZE];
+                queueFrame(reply, unit.unit.ack(reply));
+                return;
+            }
+        }
+        if (first) {
+            ++m_stats.nacks;
+            uint8_t reply[SCI_MAX_FRAME_SIZE];
+            queueFrame(reply, first->nack(reply));
+        }
+        return;
+    }
+    // Several units may share an address (PA and switch): the one that reports subCommand answers
+    VirtualUnit *first = nullptr;
+    for (Unit &unit : m_units) {
+        if (unit.unit.address() != address) {
+            continue;
+        }
+        if (!first) {
+            first = &unit.unit;
+        }
+        if (unit.unit.answers(subCommand)) {
+            ++m_stats.queries;
+            uint8_t reply[SCI_MAX_FRAME_SIZE];
+            queueFrame(reply, unit.unit.frameFor(subCommand, reply));
+            return;
+        }
+    }
+    if (first) {
+        ++m_stats.queries;
+        ++m_stats.nacks;
+        uint8_t reply[SCI_MAX_FRAME_SIZE];
+        queueFrame(reply, first->nack(reply));
+    }
+}
+
+void VirtualBus::emitFrame(Unit &unit) {
+    uint8_t frame[SCI_MAX_FRAME_SIZE];
+    queueFrame(frame, unit.unit.nextFrame(frame));
+}
+
+void VirtualBus::queueFrame(uint8_t *frame, int size) {
+    uint8_t garbage[MAX_GARBAGE_BYTES];
+    int garbageSize = 0;
+    if (chance(m_noise, m_options.garbageProbability)) {
+        garbageSize = 1 + static_cast<int>(m_noise.random() % MAX_GARBAGE_BYTES);
+        for (int i = 0; i < garbageSize; ++i) {
+            uint8_t byte = static_cast<uint8_t>(m_noise.random());
+            garbage[i] = byte == STX ? 0x00 : byte;
+        }
+    }
+    if (backlog() + static_cast<size_t>(size + garbageSize) > MAX_BACKLOG_BYTES) {
+        ++m_stats.overruns;
+        return;
+    }
+
+    if (chance(m_noise, m_options.corruptProbability)) {
+        switch (m_noise.random() % 3) {
+        case 0: // Bit error: CRC mismatch
+            frame[1 + m_noise.random() % (size - 2)] ^= static_cast<uint8_t>(1u << (m_noise.random() % 8));
+            break;
+        case 1: // Lost ETX
+            frame[size - 1] = 0x00;
+            break;
+        default: // Cut short
+            size = 2 + static_cast<int>(m_noise.random() % (size - 2));
+            break;
+        }
+        ++m_stats.corrupted;
+    }
+
+    if (m_pendingStart > m_pending.size() / 2) {
+        m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(m_pendingStart));
+        m_pendingStart = 0;
+    }
+    m_pending.insert(m_pending.end(), garbage, garbage + garbageSize);
+    m_pending.insert(m_pending.end(), frame, frame + size);
+    m_stats.garbageBytes += static_cast<uint64_t>(garbageSize);
+    ++m_stats.frames;
+}
+
+void VirtualBus::writeWire(int64_t nowNs) {
+    size_t allowed = backlog();
+    if (m_options.baudRate > 0) {
+        // 8N1: 10 bits per byte; an idle wire saves up at most a UART FIFO or 10 ms worth
+        double bytesPerNs = m_options.baudRate / 10.0 / 1e9;
+        double limit = qMax(64.0, bytesPerNs * 1e7);
+        m_wireBytes = qMin(limit, m_wireBytes + (nowNs - m_lastPollNs) * bytesPerNs);
+        allowed = qMin(allowed, static_cast<size_t>(m_wireBytes));
+    }
+    m_lastPollNs = nowNs;
+    if (allowed == 0) {
+        return;
+    }
+    ssize_t written = ::write(m_master, m_pending.data() + m_pendingStart, allowed);
+    if (written > 0) {
+        m_pendingStart += static_cast<size_t>(written);
+        m_stats.bytesWritten += static_cast<uint64_t>(written);
+        if (m_options.baudRate > 0) {
+            m_wireBytes -= written;
+        }
+    }
+    if (m_pendingStart == m_pending.size()) {
+        m_pending.clear();
+        m_pendingStart = 0;
+    }
+}
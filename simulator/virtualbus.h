@@ -0,0 +1,98 @@
+#ifndef VIRTUALBUS_H
+#define VIRTUALBUS_H
+
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "virtualunit.h"
+#include "../sciframereassembler.h"
+
+// Traffic shape of a bus
+struct BusOptions {
+    int baudRate = 19200;          // Wire speed (8N1: 10 bits per byte), 0 - unlimited
+    double framesPerSecond = 10;   // Per unit
+    double corruptProbability = 0; // Frame is damaged (bad CRC, lost ETX or cut short)
+    double garbageProbability = 0; // Noise bytes before a frame
+    double burstIntervalSec = 0;   // Every unit sends burstFrames at once this often, 0 - no bursts
+    int burstFrames = 0;
+};
+
+// Counters of one bus
+struct BusStats {
+    uint64_t frames = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t corrupted = 0;
+    uint64_t garbageBytes = 0;
+    uint64_t overruns = 0; // Frames lost because the wire could not keep up
+    uint64_t queries = 0;  // Bus master queries to the units of this bus
+    uint64_t nacks = 0;    // ... answered with NACK (sub-command the unit does not report)
+    uint64_t commands = 0; // Control commands (SCI_CONTROL_CMD) applied and answered with ACK
+};
+
+/*
+Simulated RS485 bus: a pseudo-terminal pair whose slave side is opened by
+PortListener like a real /dev/ttyUSB0 (optionally through a symlink).
+Units generate frames at their rate (0 - only when queried: a frame
+"FF <subCommand>" addressed to a unit is answered with that update or NACK,
+like a bus master would see them; control commands get ACK or NACK); the bytes leave at the configured baud
+rate, so a bus that is offered more than it can carry builds a backlog
+(bounded by MAX_BACKLOG_BYTES, further frames are counted as overruns).
+*/
+class VirtualBus {
+public:
+    // Frames waiting for the wire before new ones are dropped
+    static const int MAX_BACKLOG_BYTES = 64 * 1024;
+
+    VirtualBus(const BusOptions &options, uint32_t seed);
+    ~VirtualBus();
+    VirtualBus(const VirtualBus&) = delete;
+    VirtualBus &operator=(const VirtualBus&) = delete;
+
+    /*
+    Create the pty pair in raw mode; linkPath (optional) becomes a symlink to the slave
+    Return: false and error on failure
+    */
+    bool open(const QString &linkPath, QString *error);
+    QString slavePath() const { return m_slavePath; }
+    QString linkPath() const { return m_linkPath; }
+
+    void addUnit(UnitKind kind, uint8_t address);
+    int unitCount() const { return static_cast<int>(m_units.size()); }
+
+    // Answer queries, generate the frames due at nowNs and write what the wire allows (non-blocking)
+    void poll(int64_t nowNs);
+
+    const BusStats &stats() const { return m_stats; }
+    size_t backlog() const { return m_pending.size() - m_pendingStart; }
+
+private:
+    struct Unit {
+        VirtualUnit unit;
+        int64_t nextFrameNs;
+    };
+
+    BusOptions m_options;
+    std::vector<Unit> m_units;
+    VirtualUnit m_noise; // Random numbers for corruption and garbage
+    int m_master = -1;
+    int m_slave = -1;    // Kept open so the pty does not hang up between readers
+    QString m_slavePath;
+    QString m_linkPath;
+
+    std::vector<uint8_t> m_pending; // Bytes not on the wire yet
+    size_t m_pendingStart = 0;
+    double m_wireBytes = 0;         // Bytes the wire may carry now
+    int64_t m_lastPollNs = -1;
+    int64_t m_nextBurstNs = 0;
+    BusStats m_stats;
+    SciFrameReassembler m_framer; // Queries written by a bus master
+
+    void emitFrame(Unit &unit);
+    // Frame (possibly damaged) and noise into m_pending
+    void queueFrame(uint8_t *frame, int size);
+    // Answer a query or control command of the bus master
+    void answerQuery(const uint8_t *frame, int size);
+    void writeWire(int64_t nowNs);
+};
+
+#endif // VIRTUALBUS_H
@@ -0,0 +1,150 @@
+#include "virtualunit.h"
+#include "../scicontrol.h"
+
+namespace {
+
+// Controller address in the high nibble of Dest/Src
+const uint8_t CONTROLLER = 0x00;
+const uint8_t CMD_STATUS = 0x8;
+
+// Status frames dominate, the rest come in between
+const uint8_t PA_CYCLE[] = {0x09, 0x17, 0x09, 0x18, 0x09, 0x19, 0x09, 0x05};
+const uint8_t SWITCH_CYCLE[] = {0x06, 0x0C};
+
+} // namespace
+
+VirtualUnit::VirtualUnit(UnitKind kind, uint8_t address, uint32_t seed)
+    : m_kind(kind), m_address(address & 0x0F), m_state(seed ? seed : 1) {
+}
+
+uint32_t VirtualUnit::random() {
+    m_state = m_state * 1664525u + 1013904223u;
+    return m_state >> 8;
+}
+
+int VirtualUnit::drift(int value, int step, int low, int high) {
+    value += static_cast<int>(random() % (2 * step + 1)) - step;
+    return value < low ? low : value > high ? high : value;
+}
+
+int VirtualUnit::encode(uint8_t *out, const uint8_t *data, int length) {
+    return sciEncode(static_cast<uint8_t>(CONTROLLER | m_address), CMD_STATUS, data, length, out);
+}
+
+int VirtualUnit::nextFrame(uint8_t *out) {
+    if (m_kind == UnitKind::Switch) {
+        return frameFor(SWITCH_CYCLE[m_step++ % sizeof(SWITCH_CYCLE)], out);
+    }
+    return frameFor(PA_CYCLE[m_step++ % sizeof(PA_CYCLE)], out);
+}
+
+bool VirtualUnit::answers(uint8_t subCommand) const {
+    if (m_kind == UnitKind::Switch) {
+        return subCommand == 0x06 || subCommand == 0x0C;
+    }
+    switch (subCommand) {
+    case 0x00: case 0x03: case 0x05: case 0x09: case 0x17: case 0x18: case 0x19: case 0x21:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int VirtualUnit::nack(uint8_t *out) {
+    return sciEncode(static_cast<uint8_t>(CONTROLLER | m_address), SCI_CMD_NACK, nullptr, 0, out);
+}
+
+int VirtualUnit::ack(uint8_t *out) {
+    return sciEncode(static_cast<uint8_t>(CONTROLLER | m_address), SCI_CMD_ACK, nullptr, 0, out);
+}
+
+bool VirtualUnit::control(uint8_t subCommand, const uint8_t *value, int length) {
+    if (m_kind != UnitKind::PowerAmplifier) {
+        return false;
+    }
+    for (const SciControl &control : SCI_CONTROLS) {
+        if (control.subCommand != subCommand || control.valueBytes != length) {
+            continue;
+        }
+        int32_t number = 0;
+        for (int i = 0; i < length; ++i) {
+            number = (number << 8) | value[i];
+        }
+        if (number < control.minValue || number > control.maxValue) {
+            return false;
+        }
+        switch (control.param) {
+        case PARAM_MUTE: m_mute = static_cast<uint8_t>(number); return true;
+        case PARAM_GAIN: m_gain = number; return true;
+        case PARAM_OPERATING_IF: m_loFrequency = number; return true;
+        default: return false;
+        }
+    }
+    return false;
+}
+
+int VirtualUnit::frameFor(uint8_t subCommand, uint8_t *out) {
+    if (m_kind == UnitKind::Switch) {
+        if (random() % 200 == 0) {
+            m_switchAlarm = !m_switchAlarm;
+        }
+        if (subCommand == 0x06) {
+            if (random() % 500 == 0) {
+                m_switchPosition = m_switchPosition == 0x01 ? 0x02 : 0x01; // Changeover
+            }
+            uint8_t data[] = {0xFF, 0x06, 0x00, 0x01, m_switchPosition};
+            return encode(out, data, sizeof(data));
+        }
+        uint8_t data[] = {0xFF, 0x0C, static_cast<uint8_t>(m_switchAlarm ? 0x01 : 0x00),
+                          static_cast<uint8_t>(m_summaryAlarm ? 0x01 : 0x00), static_cast<uint8_t>(m_switchAlarm ? 0x04 : 0x00)};
+        return encode(out, data, sizeof(data));
+    }
+
+    switch (subCommand) {
+    case 0x09: {
+        m_temperature = drift(m_temperature, 1, -40, 90);
+        m_gain = drift(m_gain, 3, 0, 0xFFFF);
+        m_power = drift(m_power, 20, 0, 0xFFFF);
+        if (random() % 200 == 0) {
+            m_summaryAlarm = !m_summaryAlarm;
+        }
+        uint8_t data[] = {0xFF, 0x09, m_mute, static_cast<uint8_t>(m_summaryAlarm ? 0x80 : 0x00),
+                          static_cast<uint8_t>(m_temperature > 85 ? 0x04 : 0x00),
+                          static_cast<uint8_t>(m_temperature >> 8), static_cast<uint8_t>(m_temperature),
+                          static_cast<uint8_t>(m_gain >> 8), static_cast<uint8_t>(m_gain),
+                          static_cast<uint8_t>(m_power >> 8), static_cast<uint8_t>(m_power)};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x17: { // LO frequency and Tx band
+        uint8_t data[] = {0xFF, 0x17, 0x17, static_cast<uint8_t>(m_loFrequency >> 8), static_cast<uint8_t>(m_loFrequency),
+                          0x00, 0x00, 0x00};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x18: { // Output frequency
+        uint8_t data[] = {0xFF, 0x18, 0x36, 0xB0};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x00: { // SW version 01.02.03.04-05.06-AB
+        uint8_t data[] = {0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 'A', 'B'};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x03: { // Frequency band
+        uint8_t data[] = {0xFF, 0x03, 0x00};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x21: { // Host name
+        uint8_t data[] = {0xFF, 0x21, 'V', 'I', 'R', 'T', 'U', 'A', 'L', '-', 'P', 'A', static_cast<uint8_t>("0123456789ABCDEF"[m_address])};
+        return encode(out, data, sizeof(data));
+    }
+    case 0x19: { // Input DC voltage
+        m_voltage = drift(m_voltage, 2, 0, 0xFFFF);
+        uint8_t data[] = {0xFF, 0x19, static_cast<uint8_t>(m_voltage >> 8), static_cast<uint8_t>(m_voltage)};
+        return encode(out, data, sizeof(data));
+    }
+    default: { // 0x05 alarm log entry of this PA: event 0x11-0x13 (log 1-3), alarm code
+        uint8_t data[] = {0xFF, 0x05, static_cast<uint8_t>(0x11 + random() % 3), static_cast<uint8_t>(random()),
+                          static_cast<uint8_t>(random()), 0x01};
+        return encode(out, data, sizeof(data));
+    }
+    }
+}
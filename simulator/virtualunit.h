@@ -0,0 +1,64 @@
+#ifndef VIRTUALUNIT_H
+#define VIRTUALUNIT_H
+
+#include <cstdint>
+#include "../sciprotocol.h"
+
+// What a simulated unit reports
+enum class UnitKind {
+    PowerAmplifier, // UPD (0x09), frequency (0x17/0x18), voltage (0x19), alarm log (0x05)
+    Switch          // Redundant system status (0x06), system and switch alarms (0x0C)
+};
+
+/*
+One simulated unit on the bus: a fixed cycle of unsolicited 0x8 frames with
+values that drift like real telemetry (temperature, gain, power, voltage) and
+alarms that are raised and cleared now and then.
+Deterministic for a given seed.
+*/
+class VirtualUnit {
+public:
+    VirtualUnit(UnitKind kind, uint8_t address, uint32_t seed);
+
+    UnitKind kind() const { return m_kind; }
+    uint8_t address() const { return m_address; }
+    // Encode the next frame of the cycle into out (SCI_MAX_FRAME_SIZE bytes), return its size
+    int nextFrame(uint8_t *out);
+    // Sub-commands this kind of unit answers when queried by a bus master
+    bool answers(uint8_t subCommand) const;
+    // Same for the answer to a query of subCommand (answers() must be true)
+    int frameFor(uint8_t subCommand, uint8_t *out);
+    // NACK from this unit (query it does not answer)
+    int nack(uint8_t *out);
+    /*
+    Apply a control command "FF <subCommand> <value>" (see SCI_CONTROLS)
+    Return: false if this unit has no such control or the value does not fit
+    */
+    bool control(uint8_t subCommand, const uint8_t *value, int length);
+    // ACK from this unit (control command applied)
+    int ack(uint8_t *out);
+
+    // Pseudo-random numbers shared with the bus (corruption, garbage)
+    uint32_t random();
+
+private:
+    UnitKind m_kind;
+    uint8_t m_address;
+    uint32_t m_state;
+    int m_step = 0;
+
+    int m_temperature = 45;
+    int m_gain = 600;
+    uint8_t m_mute = 0;
+    int m_loFrequency = 0x32FA;
+    int m_power = 3000;
+    int m_voltage = 480;
+    bool m_summaryAlarm = false;
+    bool m_switchAlarm = false;
+    uint8_t m_switchPosition = 0x01;
+
+    int drift(int value, int step, int low, int high);
+    int encode(uint8_t *out, const uint8_t *data, int length);
+};
+
+#endif // VIRTUALUNIT_H
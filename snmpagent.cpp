@@ -0,0 +1,371 @@
+#include "snmpagent.h"
+#include <QDebug>
+#include <cstring>
+#include "log.h"
+
+SnmpAgent::SnmpAgent(const OidStore *store, const QString &community, QObject *parent)
+    : QObject(parent), m_store(store), m_socket(new QUdpSocket(this)), m_community(community.toLatin1()), m_setTimer(this) {
+    connect(m_socket, &QUdpSocket::readyRead, this, &SnmpAgent::readPendingDatagrams);
+    for (PendingSet &set : m_pending) {
+        set.used = false;
+    }
+    m_clock.start();
+    m_setTimer.setSingleShot(true);
+    connect(&m_setTimer, &QTimer::timeout, this, &SnmpAgent::expireSets);
+}
+
+bool SnmpAgent::listen(const QHostAddress &address, quint16 port) {
+    if (!m_socket->bind(address, port)) {
+        QString err = "SNMP agent failed to bind " + address.toString() + ":" + QString::number(port) + ": " + m_socket->errorString();
+        qWarning() << err;
+        emit errorOccurred(err);
+        return false;
+    }
+    qDebug() << "SNMP agent listening on" << address.toString() << ":" << port;
+    return true;
+}
+
+void SnmpAgent::setCommunity(const QString &community) {
+    m_community = community.toLatin1();
+}
+
+void SnmpAgent::setWriteCommunity(const QString &community) {
+    m_writeCommunity = community.toLatin1();
+}
+
+void SnmpAgent::setCommandTarget(SciCommandTarget *target, int timeoutMs) {
+    m_target = target;
+    m_setTimeoutMs = timeoutMs > 0 ? timeoutMs : DEFAULT_SET_TIMEOUT_MS;
+}
+
+void SnmpAgent::readPendingDatagrams() {
+    while (m_socket->hasPendingDatagrams()) {
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        qint64 size = m_socket->readDatagram(reinterpret_cast<char*>(m_request), sizeof(m_request), &sender, &senderPort);
+        if (size <= 0) {
+            continue;
+        }
+        ++m_requests;
+        if (handleRequest(m_request, static_cast<int>(size), sender, senderPort)) {
+            sendResponse(sender, senderPort);
+        }
+    }
+}
+
+void SnmpAgent::sendResponse(const QHostAddress &address, quint16 port) {
+    if (m_socket->writeDatagram(m_response.data(), m_response.size(), address, port) == -1) {
+        LOG_WARNING(LOG_SNMP, "SNMP agent response failed: {}", m_socket->errorString());
+        return;
+    }
+    ++m_responses;
+    LOG_TRACE(LOG_SNMP, "SNMP agent response to {}:{} : {}", address.toString(), port,
+              logHex(m_response.data(), m_response.size()));
+}
+
+bool SnmpAgent::handleRequest(const uint8_t *data, int size, const QHostAddress &sender, quint16 senderPort) {
+    // Message: SEQUENCE { version, community, PDU }
+    BerReader reader(data, size);
+    BerReader message;
+    int32_t version;
+    const uint8_t *community;
+    int communityLength;
+    if (!reader.enter(BER_SEQUENCE, message) || !message.readInteger(version)
+        || !message.readOctetString(community, communityLength)) {
+        ++m_parseErrors;
+        return false;
+    }
+    if (version != SNMP_VERSION_1 && version != SNMP_VERSION_2C) {
+        ++m_parseErrors;
+        return false;
+    }
+    // Read community, or the write community that may read as well
+    bool readAccess = communityLength == m_community.size()
+        && memcmp(community, m_community.constData(), communityLength) == 0;
+    bool writeAccess = !m_writeCommunity.isEmpty() && communityLength == m_writeCommunity.size()
+        && memcmp(community, m_writeCommunity.constData(), communityLength) == 0;
+    uint8_t pduType = message.peekTag();
+    if (pduType == SnmpPduBuilder::SET_REQUEST ? !writeAccess : !(readAccess || writeAccess)) {
+        ++m_badCommunity;
+        return false;
+    }
+
+    // PDU: request-id, error-status (non-repeaters), error-index (max-repetitions), VarBindList
+    if (pduType != SnmpPduBuilder::GET_REQUEST && pduType != SnmpPduBuilder::GET_NEXT_REQUEST
+        && pduType != SnmpPduBuilder::SET_REQUEST
+        && !(pduType == SnmpPduBuilder::GET_BULK_REQUEST && version == SNMP_VERSION_2C)) {
+        ++m_parseErrors; // Unknown PDUs are not served
+        return false;
+    }
+    BerReader pdu;
+    BerReader varbinds;
+    int32_t requestId;
+    int32_t field2;
+    int32_t field3;
+    if (!message.enter(pduType, pdu) || !pdu.readInteger(requestId) || !pdu.readInteger(field2)
+        || !pdu.readInteger(field3) || !pdu.enter(BER_SEQUENCE, varbinds)) {
+        ++m_parseErrors;
+        return false;
+    }
+
+    // Requested OIDs (values of a GET are NULL and ignored, SET keeps INTEGER values)
+    int count = 0;
+    while (!varbinds.atEnd()) {
+        BerReader varbind;
+        if (count == MAX_REQUEST_VARBINDS || !varbinds.enter(BER_SEQUENCE, varbind)
+            || !varbind.readOid(m_requestOids[count])) {
+            ++m_parseErrors;
+            return false;
+        }
+        m_requestTypes[count] = varbind.peekTag();
+        m_requestValues[count] = 0;
+        if (pduType == SnmpPduBuilder::SET_REQUEST && m_requestTypes[count] == BER_INTEGER
+            && !varbind.readInteger(m_requestValues[count])) {
+            ++m_parseErrors;
+            return false;
+        }
+        ++count;
+    }
+
+    m_response.setHeader(reinterpret_cast<const char*>(community), communityLength, version);
+    m_response.clear();
+    int errorStatus = SnmpPduBuilder::NO_ERROR;
+    int errorIndex = 0;
+    if (pduType == SnmpPduBuilder::SET_REQUEST) {
+        ++m_sets;
+        if (count > 0) {
+            errorStatus = startSet(static_cast<uint32_t>(requestId), version, community, communityLength, count,
+                                   sender, senderPort, errorIndex);
+            if (errorStatus == SnmpPduBuilder::NO_ERROR) {
+                return false; // Answered by completeSet()
+            }
+            ++m_setErrors;
+        }
+    } else if (pduType == SnmpPduBuilder::GET_BULK_REQUEST) {
+        answerBulk(count, field2, field3);
+    } else {
+        errorStatus = answerGet(pduType, version, count, errorIndex);
+    }
+    if (errorStatus != SnmpPduBuilder::NO_ERROR) {
+        // Errors carry the request varbinds back; tooBig carries none
+        m_response.clear();
+        if (errorStatus != SnmpPduBuilder::TOO_BIG) {
+            for (int i = 0; i < count; ++i) {
+                bool integer = pduType == SnmpPduBuilder::SET_REQUEST && m_requestTypes[i] == BER_INTEGER;
+                m_response.add(m_requestOids[i], integer ? SnmpValue::integer(m_requestValues[i]) : SnmpValue());
+            }
+        }
+    }
+    if (!m_response.build(static_cast<uint32_t>(requestId), SnmpPduBuilder::GET_RESPONSE, errorStatus, errorIndex)) {
+        ++m_parseErrors;
+        return false;
+    }
+    return true;
+}
+
+int SnmpAgent::startSet(uint32_t requestId, int version, const uint8_t *community, int communityLength, int count,
+                        const QHostAddress &sender, quint16 senderPort, int &errorIndex) {
+    bool v1 = version == SNMP_VERSION_1;
+    // Nothing is sent unless every varbind is acceptable
+    int controls[MAX_REQUEST_VARBINDS];
+    int units[MAX_REQUEST_VARBINDS];
+    for (int i = 0; i < count; ++i) {
+        errorIndex = i + 1;
+        controls[i] = sciFindControl(m_requestOids[i], units[i]);
+        if (controls[i] < 0) {
+            return v1 ? SnmpPduBuilder::NO_SUCH_NAME : SnmpPduBuilder::NOT_WRITABLE;
+        }
+        if (m_requestTypes[i] != BER_INTEGER) {
+            return v1 ? SnmpPduBuilder::BAD_VALUE : SnmpPduBuilder::WRONG_TYPE;
+        }
+        const SciControl &control = SCI_CONTROLS[controls[i]];
+        if (m_requestValues[i] < control.minValue || m_requestValues[i] > control.maxValue) {
+            return v1 ? SnmpPduBuilder::BAD_VALUE : SnmpPduBuilder::WRONG_VALUE;
+        }
+    }
+    errorIndex = 0;
+    PendingSet *set = nullptr;
+    for (PendingSet &slot : m_pending) {
+        if (!slot.used) {
+            set = &slot;
+            break;
+        }
+    }
+    if (!set || count > MAX_SET_VARBINDS || !m_target) {
+        return v1 ? SnmpPduBuilder::GEN_ERR : SnmpPduBuilder::RESOURCE_UNAVAILABLE;
+    }
+
+    set->used = true;
+    set->serial = ++m_setSerial;
+    set->requestId = requestId;
+    set->version = version;
+    set->sender = sender;
+    set->senderPort = senderPort;
+    set->communityLength = qMin(communityLength, static_cast<int>(sizeof(set->community)));
+    memcpy(set->community, community, set->communityLength);
+    set->count = count;
+    set->outstanding = 0;
+    set->deadlineMs = m_clock.elapsed() + m_setTimeoutMs;
+    for (int i = 0; i < count; ++i) {
+        set->oids[i] = m_requestOids[i];
+        set->values[i] = m_requestValues[i];
+        set->results[i] = -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        uint64_t token = (static_cast<uint64_t>(set->serial) << 8) | static_cast<uint64_t>(i);
+        uint8_t address = static_cast<uint8_t>(0xA + units[i]);
+        if (m_target->submitCommand(address, controls[i], set->values[i], token)) {
+            ++set->outstanding;
+        } else {
+            set->results[i] = static_cast<int>(SciControlResult::Rejected);
+        }
+    }
+    LOG_DEBUG(LOG_SNMP, "SNMP SET {} from {}: {} commands queued", requestId, sender.toString(), set->outstanding);
+    if (set->outstanding == 0) {
+        completeSet(*set);
+    } else {
+        scheduleSetTimeout();
+    }
+    return SnmpPduBuilder::NO_ERROR;
+}
+
+void SnmpAgent::commandFinished(quint64 token, int result) {
+    uint32_t serial = static_cast<uint32_t>(token >> 8);
+    int index = static_cast<int>(token & 0xFF);
+    for (PendingSet &set : m_pending) {
+        if (!set.used || set.serial != serial || index >= set.count || set.results[index] >= 0) {
+            continue;
+        }
+        set.results[index] = result;
+        if (--set.outstanding == 0) {
+            completeSet(set);
+        }
+        return;
+    }
+    // SET already answered (timed out)
+}
+
+void SnmpAgent::completeSet(PendingSet &set) {
+    bool v1 = set.version == SNMP_VERSION_1;
+    int errorStatus = SnmpPduBuilder::NO_ERROR;
+    int errorIndex = 0;
+    for (int i = 0; i < set.count && errorStatus == SnmpPduBuilder::NO_ERROR; ++i) {
+        switch (set.results[i]) {
+        case static_cast<int>(SciControlResult::Ack):
+            continue;
+        case static_cast<int>(SciControlResult::Nack):
+            errorStatus = v1 ? SnmpPduBuilder::BAD_VALUE : SnmpPduBuilder::WRONG_VALUE;
+            break;
+        case static_cast<int>(SciControlResult::Rejected):
+            errorStatus = v1 ? SnmpPduBuilder::GEN_ERR : SnmpPduBuilder::RESOURCE_UNAVAILABLE;
+            break;
+        default: // Timeout, or still waiting at the deadline
+            errorStatus = v1 ? SnmpPduBuilder::GEN_ERR : SnmpPduBuilder::COMMIT_FAILED;
+            break;
+        }
+        errorIndex = i + 1;
+    }
+    if (errorStatus != SnmpPduBuilder::NO_ERROR) {
+        ++m_setErrors;
+    }
+    set.used = false;
+
+    // The response echoes the request varbinds
+    m_response.setHeader(set.community, set.communityLength, set.version);
+    m_response.clear();
+    for (int i = 0; i < set.count; ++i) {
+        m_response.add(set.oids[i], SnmpValue::integer(set.values[i]));
+    }
+    if (!m_response.build(set.requestId, SnmpPduBuilder::GET_RESPONSE, errorStatus, errorIndex)) {
+        return;
+    }
+    LOG_DEBUG(LOG_SNMP, "SNMP SET {} done, error-status {} index {}", set.requestId, errorStatus, errorIndex);
+    sendResponse(set.sender, set.senderPort);
+}
+
+void SnmpAgent::expireSets() {
+    qint64 now = m_clock.elapsed();
+    for (PendingSet &set : m_pending) {
+        if (set.used && set.deadlineMs <= now) {
+            completeSet(set);
+        }
+    }
+    scheduleSetTimeout();
+}
+
+void SnmpAgent::scheduleSetTimeout() {
+    qint64 nearest = -1;
+    for (const PendingSet &set : m_pending) {
+        if (set.used && (nearest < 0 || set.deadlineMs < nearest)) {
+            nearest = set.deadlineMs;
+        }
+    }
+    if (nearest < 0) {
+        m_setTimer.stop();
+        return;
+    }
+    qint64 delay = nearest - m_clock.elapsed();
+    m_setTimer.start(static_cast<int>(delay > 0 ? delay : 0));
+}
+
+int SnmpAgent::answerGet(uint8_t pduType, int version, int count, int &errorIndex) {
+    for (int i = 0; i < count; ++i) {
+        const SnmpOid &oid = m_requestOids[i];
+        const OidStore::Entry *entry = pduType == SnmpPduBuilder::GET_REQUEST ? m_store->find(oid) : m_store->next(oid);
+        bool added;
+        if (entry) {
+            added = m_response.add(entry->oid, entry->value());
+        } else if (version == SNMP_VERSION_1) {
+            errorIndex = i + 1;
+            return SnmpPduBuilder::NO_SUCH_NAME;
+        } else {
+            SnmpValue exception;
+            exception.type = pduType == SnmpPduBuilder::GET_REQUEST ? BER_NO_SUCH_OBJECT : BER_END_OF_MIB_VIEW;
+            added = m_response.add(oid, exception);
+        }
+        if (!added) {
+            return SnmpPduBuilder::TOO_BIG;
+        }
+    }
+    return SnmpPduBuilder::NO_ERROR;
+}
+
+void SnmpAgent::answerBulk(int count, int nonRepeaters, int maxRepetitions) {
+    if (nonRepeaters < 0) nonRepeaters = 0;
+    if (nonRepeaters > count) nonRepeaters = count;
+    if (maxRepetitions < 0) maxRepetitions = 0;
+
+    SnmpValue endOfMibView;
+    endOfMibView.type = BER_END_OF_MIB_VIEW;
+
+    // Non-repeaters: one GETNEXT each
+    for (int i = 0; i < nonRepeaters; ++i) {
+        const OidStore::Entry *entry = m_store->next(m_requestOids[i]);
+        bool added = entry ? m_response.add(entry->oid, entry->value()) : m_response.add(m_requestOids[i], endOfMibView);
+        if (!added) {
+            return;
+        }
+    }
+    // Repeaters: walk each column maxRepetitions steps, stop when the response is full
+    for (int repetition = 0; repetition < maxRepetitions; ++repetition) {
+        bool anyLeft = false;
+        for (int i = nonRepeaters; i < count; ++i) {
+            SnmpOid &cursor = m_requestOids[i];
+            const OidStore::Entry *entry = m_store->next(cursor);
+            bool added;
+            if (entry) {
+                added = m_response.add(entry->oid, entry->value());
+                cursor = entry->oid;
+                anyLeft = true;
+            } else {
+                added = m_response.add(cursor, endOfMibView);
+            }
+            if (!added) {
+                return; // Truncated response is allowed for GETBULK
+            }
+        }
+        if (!anyLeft) {
+            return; // Every column reached endOfMibView
+        }
+    }
+}
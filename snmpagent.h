@@ -0,0 +1,135 @@
+#ifndef SNMPAGENT_H
+#define SNMPAGENT_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "ber.h"
+#include "oidstore.h"
+#include "snmppdu.h"
+#include "scicontrol.h"
+
+/*
+SNMP agent answering GET, GETNEXT (v1, v2c) and GETBULK (v2c) from the OidStore.
+Runs in the converter thread: requests are answered from the in-memory
+store and never wait for the serial bus.
+Requests are decoded in place from a fixed receive buffer and answered
+through one SnmpPduBuilder, so serving a request does not allocate.
+Missing objects: v1 responds with noSuchName, v2c with noSuchObject /
+endOfMibView exception values. Requests with another community are dropped.
+SET is served with the write community for the objects of SCI_CONTROLS:
+the values are checked at once (notWritable, wrongType, wrongValue; v1
+noSuchName/badValue), handed to the command target and the response is sent
+when every command is acknowledged, refused or the SET timeout expires. SET
+is not atomic: commands acknowledged before another one fails stay applied.
+*/
+class SnmpAgent : public QObject {
+    Q_OBJECT
+public:
+    explicit SnmpAgent(const OidStore *store, const QString &community = "public", QObject *parent = nullptr);
+
+    // Bind the UDP socket; false (and errorOccurred) on failure
+    bool listen(const QHostAddress &address, quint16 port);
+    void setCommunity(const QString &community);
+    // Upper limit for one response (UDP payload)
+    void setMaxResponseSize(int size) { m_response.setMaxSize(size); }
+    // SET is accepted with this community only (empty - SET is not served); it may also read
+    void setWriteCommunity(const QString &community);
+    // Receiver of the SET commands, results come back through commandFinished()
+    void setCommandTarget(SciCommandTarget *target, int timeoutMs = DEFAULT_SET_TIMEOUT_MS);
+
+    // Statistics
+    uint64_t requests() const { return m_requests; }
+    uint64_t responses() const { return m_responses; }
+    uint64_t badCommunity() const { return m_badCommunity; }
+    uint64_t parseErrors() const { return m_parseErrors; }
+    uint64_t sets() const { return m_sets; }
+    // SETs answered with an error
+    uint64_t setErrors() const { return m_setErrors; }
+
+    static const int DEFAULT_SET_TIMEOUT_MS = 5000;
+
+public slots:
+    void readPendingDatagrams();
+    // Result (SciControlResult) of a command submitted for a pending SET
+    void commandFinished(quint64 token, int result);
+
+signals:
+    void errorOccurred(const QString &err);
+
+private:
+    // GETBULK repetitions are limited by the response size and MAX_VARBINDS anyway
+    static const int MAX_REQUEST_VARBINDS = SnmpPduBuilder::MAX_VARBINDS;
+    // SETs waiting for their commands, and varbinds of one SET
+    static const int MAX_PENDING_SETS = 8;
+    static const int MAX_SET_VARBINDS = 8;
+
+    // SET waiting for the ACK/NACK of its commands
+    struct PendingSet {
+        bool used;
+        uint32_t serial;             // Command tokens are serial << 8 | varbind index
+        uint32_t requestId;
+        int version;
+        QHostAddress sender;
+        quint16 senderPort;
+        char community[SnmpPduBuilder::MAX_COMMUNITY_LENGTH];
+        int communityLength;
+        int count;
+        SnmpOid oids[MAX_SET_VARBINDS];
+        int32_t values[MAX_SET_VARBINDS];
+        int results[MAX_SET_VARBINDS]; // SciControlResult, -1 while waiting
+        int outstanding;
+        qint64 deadlineMs;
+    };
+
+    const OidStore *m_store;
+    QUdpSocket *m_socket;
+    QByteArray m_community;
+    QByteArray m_writeCommunity;
+    SnmpPduBuilder m_response;
+    uint8_t m_request[SnmpPduBuilder::MAX_MESSAGE_SIZE];
+    SnmpOid m_requestOids[MAX_REQUEST_VARBINDS];
+    uint8_t m_requestTypes[MAX_REQUEST_VARBINDS];  // Value tags of a SET
+    int32_t m_requestValues[MAX_REQUEST_VARBINDS]; // INTEGER values of a SET
+
+    SciCommandTarget *m_target = nullptr;
+    int m_setTimeoutMs = DEFAULT_SET_TIMEOUT_MS;
+    PendingSet m_pending[MAX_PENDING_SETS];
+    uint32_t m_setSerial = 0;
+    QElapsedTimer m_clock;  // SET deadlines
+    QTimer m_setTimer;
+
+    uint64_t m_requests = 0;
+    uint64_t m_responses = 0;
+    uint64_t m_badCommunity = 0;
+    uint64_t m_parseErrors = 0;
+    uint64_t m_sets = 0;
+    uint64_t m_setErrors = 0;
+
+    /*
+    Decode one request and build the response in m_response
+    Return: false if nothing has to be sent now (malformed, wrong community, unsupported PDU, SET in progress)
+    */
+    bool handleRequest(const uint8_t *data, int size, const QHostAddress &sender, quint16 senderPort);
+    void sendResponse(const QHostAddress &address, quint16 port);
+    /*
+    Check the SET varbinds and submit their commands
+    Return: error-status to answer at once (errorIndex is 1-based), NO_ERROR if the SET waits for the bus
+    */
+    int startSet(uint32_t requestId, int version, const uint8_t *community, int communityLength, int count,
+                 const QHostAddress &sender, quint16 senderPort, int &errorIndex);
+    // All commands of the SET finished (or its deadline passed): send the response, free the slot
+    void completeSet(PendingSet &set);
+    // Arm m_setTimer for the nearest SET deadline
+    void scheduleSetTimeout();
+    // Fill m_response for GET/GETNEXT; return error-status, errorIndex is 1-based
+    int answerGet(uint8_t pduType, int version, int count, int &errorIndex);
+    void answerBulk(int count, int nonRepeaters, int maxRepetitions);
+
+private slots:
+    void expireSets();
+};
+
+#endif // SNMPAGENT_H
@@ -2,64 +2,195 @@
 #define SNMPCONVERTER_H
 
 #include <QObject>
-#include <QUdpSocket>
 #include <QHostAddress>
-#include <QNetworkInterface>
-#include <vector>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "sciprotocol.h"
+#include "scihandlers.h"
+#include "snmpoids.h"
+#include "snmppdu.h"
+#include "routecache.h"
+#include "framequeue.h"
+#include "oidstore.h"
+#include "updatefilter.h"
+#include "snmpnotifier.h"
+#include "histogram.h"
+#include "udpsender.h"
+#include "statefile.h"
 
-// Константы для SCI-пакетов
-const uint8_t STX = 0x7E; // start byte
-const uint8_t ETX = 0x7F; // end byte
+// One receiver of the unsolicited messages ([SNMP] or [Destination.N])
+struct DestinationConfig {
+    QHostAddress address;
+    quint16 port = 161;
+    QString community = "public";
+    int version = SNMP_VERSION_1;
+    int ratePerSec = 0;                          // Messages per second, 0 - unlimited
+    int burst = 10;
+    int queueSize = UdpSender::DEFAULT_CAPACITY; // Messages waiting for this destination
+};
 
-// Структура SCI-пакета
-struct SCIPacket {
-    uint8_t destSrc;      // Байт Dest/Src
-    uint8_t cmd;          // Команда (извлекается из cmdLen)
-    uint8_t len;          // Длина данных (извлекается из cmdLen)
-    std::vector<uint8_t> data; // Данные пакета
-    uint8_t crc;          // CRC
+// Why a pending message was sent
+enum FlushReason {
+    FLUSH_FRAME,  // End of an SCI frame (no coalescing window)
+    FLUSH_WINDOW, // Coalescing window expired
+    FLUSH_SIZE,   // maxPduSize or the varbind limit reached
+    FLUSH_ALARM,  // Frame changed an alarm
+    FLUSH_REASON_COUNT
 };
 
-class SnmpConverter : public QObject {
+class SnmpConverter : public QObject, private SciOutput {
     Q_OBJECT
 public:
-    explicit SnmpConverter(const QHostAddress &udpAddress, quint16 udpPort, const QHostAddress &subnetMask, const QHostAddress &gateway, int listenAddress = -1, QObject *parent = nullptr);
+    explicit SnmpConverter(const QHostAddress &subnetMask, const QHostAddress &gateway, int listenAddress = -1, QObject *parent = nullptr);
     ~SnmpConverter();
 
+    /*
+    Add a receiver of every message. Each destination has its own send queue and
+    rate limit; the PDU is encoded once and only the version/community header is
+    encoded per (version, community) pair.
+    Return: destination index
+    */
+    int addDestination(const DestinationConfig &config);
+    int destinationCount() const { return m_destinations.size(); }
+    const DestinationConfig &destination(int index) const { return m_destinations[index].config; }
+    const UdpSender *sender(int destination) const { return m_destinations[destination].sender; }
+    // Messages of every destination go to sink instead of the network (nullptr - network)
+    void setSink(DatagramSink *sink);
+
+    // Upper limit for one SNMP message (UDP payload), default fits Ethernet MTU
+    void setMaxPduSize(int size) { m_pdu.setMaxSize(size); }
+    /*
+    Coalescing: varbinds of consecutive frames (0x06 status, 0x0C alarms, 0x17/0x18/0x19 ...)
+    are collected for up to windowMs after the first one and sent as one message.
+    maxVarbinds > 0 sends earlier when that many are pending (maxPduSize always applies).
+    Frames that change an alarm are sent immediately. windowMs 0: one message per frame
+    */
+    void setCoalescing(int windowMs, int maxVarbinds = 0);
+    // Send what is pending now (shutdown)
+    void flushPending() { flushPdu(FLUSH_WINDOW); }
+    // Time from the first pending varbind to the send, microseconds
+    const Histogram &flushLatency() const { return m_flushLatency; }
+    // Varbinds per sent message
+    const Histogram &batchSize() const { return m_batchSize; }
+    uint64_t flushes(FlushReason reason) const { return m_flushes[reason]; }
+    // Varbinds dropped because they do not fit into an empty message
+    uint64_t oversizedVarbinds() const { return m_oversizedVarbinds; }
+    // Period of the route cache refresh, 0 - refresh on network changes only
+    void setRouteRefreshInterval(int intervalMs) { m_routes->setRefreshInterval(intervalMs); }
+    const RouteCache *routeCache() const { return m_routes; }
+    /*
+    Register a queue filled by a serial I/O thread, drained by processQueuedFrames().
+    listenAddress filters units of this bus (-1 - all)
+    Return: source index for framesConverted()
+    */
+    int addFrameSource(FrameQueue *queue, int listenAddress = -1);
+    // Last value of every object, served by SnmpAgent
+    const OidStore *store() const { return &m_store; }
+    // Same for objects that do not come from SCI frames (MetricsServer)
+    OidStore *store() { return &m_store; }
+    // Change detection / deadband rules for the unsolicited messages
+    UpdateFilter &filter() { return m_filter; }
+    const UpdateFilter &filter() const { return m_filter; }
+    // Send a trap/inform for every alarm state change (nullptr disables)
+    void setNotifier(SnmpNotifier *notifier) { m_notifier = notifier; }
+    const SnmpNotifier *notifier() const { return m_notifier; }
+    // Send unsolicited GetResponse messages to every destination (on by default)
+    void setSendUpdates(bool enabled) { m_sendUpdates = enabled; }
+    // Frames rejected by sciDecode() for the reason (conversion thread only)
+    uint64_t sciErrors(SciStatus status) const { return m_sciErrors[static_cast<int>(status)]; }
+    /*
+    Warm restart: put the values of state (changed at most maxAgeSec ago, 0 - any age)
+    into the store and, with announce, send them like freshly decoded ones; every
+    later decoded change is written to state. Alarms restored this way raise no
+    notification, only a change after the restart does
+    Return: number of restored values
+    */
+    int setStateFile(StateFile *state, bool announce, int maxAgeSec = 0);
+    const StateFile *stateFile() const { return m_state; }
+    // Forget all sources (their queues are about to be destroyed)
+    void clearFrameSources() { m_sources.clear(); }
+    // Frames taken from the source so far (conversion thread only)
+    uint64_t framesConverted(int source) const { return m_sources[source].frames; }
+
 private:
-    QUdpSocket *m_udpSocket;
-    QHostAddress m_udpAddress;
-    quint16 m_udpPort;
-    QHostAddress m_subnetMask; // Маска подсети
-    QHostAddress m_gateway;    // Шлюз по умолчанию
-    QByteArray snmpPacket;
-    QString community = "public";  // SNMP community string
+    struct Destination {
+        DestinationConfig config;
+        int routeIndex; // In m_routes
+        int header;     // In m_headers
+        UdpSender *sender; // Messages of one processQueuedFrames() call go out in one sendmmsg()
+    };
+    // Distinct (version, community) of the destinations and its prefix for the current message
+    struct HeaderGroup {
+        SnmpHeader header;
+        char prefix[SnmpPduBuilder::MAX_PREFIX_SIZE];
+        int prefixSize;
+    };
+    QVector<Destination> m_destinations;
+    QVector<HeaderGroup> m_headers;
+    bool m_draining = false;   // Inside processQueuedFrames(): senders are flushed at its end
+    DatagramSink *m_sink = nullptr;
+    RouteCache *m_routes;      // Cached next hop (direct or gateway)
+    SnmpPduBuilder m_pdu;          // Varbinds of the SCI frame being processed, header encoded once
     uint32_t requestId = 1;        // SNMP request ID, starts at 1
     int m_listenAddress = -1;      // -1 for all addresses, otherwise specific address
+    OidStore m_store;              // Values for the agent, updated by every decoded frame
+    bool m_sendUpdates = true;     // false: only the store is updated (agent mode)
+    UpdateFilter m_filter;         // Drops unchanged values before they reach m_pdu
+    QElapsedTimer m_clock;         // Monotonic time for m_filter
+    SnmpNotifier *m_notifier = nullptr; // Traps/informs on alarm edges
+    StateFile *m_state = nullptr;  // Decoded values survive a restart
 
-    // Проверка, находится ли адрес в той же подсети
-    bool isInSameSubnet(const QHostAddress &address) const;
+    int m_coalesceWindowMs = 0;    // 0: flush at the end of every frame
+    int m_coalesceMaxVarbinds = 0; // 0: limited by maxPduSize only
+    QTimer m_coalesceTimer;        // Started by the first varbind of a message
+    qint64 m_pendingSinceNs = 0;   // m_clock time of the first pending varbind
+    int64_t m_frameReceivedNs = 0; // Metrics::now() of the read that delivered the frame being decoded
+    int64_t m_pendingFrameNs = 0;  // Same for the oldest frame of the pending message
+    int64_t m_nestedFlushNs = 0;   // Spent in flushPdu() during the current decode, left out of STAGE_DECODE
+    bool m_alarmChanged = false;   // Current frame changed an alarm: flush without waiting
+    Histogram m_flushLatency;
+    Histogram m_batchSize;
+    uint64_t m_flushes[FLUSH_REASON_COUNT] = {};
+    uint64_t m_oversizedVarbinds = 0;
 
-    // Reading SCI packet
-    SCIPacket readSCI(const QByteArray &sciData);
-    /*
-     * Calculate CRC byte
-     * Return: calculated CRC
-    */
-    uint8_t calculateCRC(const QByteArray &data);
+    // Queue of one serial port and its address filter
+    struct FrameSource {
+        FrameQueue *queue;
+        int listenAddress;
+        uint64_t frames;
+    };
+    QVector<FrameSource> m_sources; // Frames from the serial I/O threads
+
+    // Minimum period between errorOccurred signals about rejected frames
+    static const int SCI_ERROR_REPORT_INTERVAL_MS = 1000;
+    uint64_t m_sciErrors[SCI_STATUS_COUNT] = {};         // Rejected frames per reason
+    uint64_t m_sciErrorsReported[SCI_STATUS_COUNT] = {}; // Values at the last errorOccurred
+    QElapsedTimer m_sciErrorReport;
+
+    // Count a rejected frame, emit errorOccurred at most once per SCI_ERROR_REPORT_INTERVAL_MS
+    void reportSciError(SciStatus status);
     /*
-    *Receive readed data from port
+    *Receive readed data from port: one frame (STX ... ETX), decoded in place
     *
     */
-    void processSciData(const QByteArray &sciData);
-    void buildSnmpPacket(const QByteArray &oid, int32_t value, int valueType, bool isSigned = false);
+    void processSciData(const uint8_t *frame, int size, int listenAddress);
+    // Add varbind to the message of the current SCI frame (SciOutput of the handlers)
+    void addVarbind(const SnmpOid &oid, const SnmpValue &value) final;
+    // Same for an alarm object: a changed value also goes out as a notification
+    void addAlarmVarbind(const SnmpOid &oid, const SnmpValue &value, uint8_t src) final;
+    // Frame done: flush unless the coalescing window keeps the message open
+    void endFrame();
+    // Send collected varbinds as one GetResponse-PDU
+    void flushPdu(FlushReason reason);
+    // Queue the last built message to every destination
     void sendSnmpPacket();
-    void encodeLength(QByteArray &buffer, int length);
-    void encodeOID(QByteArray &buffer, const QByteArray &oid);
-    void encodeInteger(QByteArray &buffer, int32_t value, bool isSigned);
+    void flushSenders();
 
 public slots:
     void processSciDataSlot(const QByteArray &sciData);
+    // Slot: convert every frame waiting in the frame queues of all sources
+    void processQueuedFrames();
 
 signals:
     void snmpPacketSent(const QByteArray &packet);
@@ -0,0 +1,276 @@
+#include "snmpnotifier.h"
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+#include "log.h"
+
+SnmpNotifier::SnmpNotifier(const OidStore *store, QObject *parent)
+    : QObject(parent), m_store(store), m_socket(new QUdpSocket(this)), m_collapseTimer(this), m_retransmitTimer(this) {
+    m_clock.start();
+    for (TokenBucket &bucket : m_buckets) {
+        bucket.tokens = m_burst;
+        bucket.updatedMs = 0;
+        bucket.collapsedCount = 0;
+    }
+    for (PendingInform &inform : m_pending) {
+        inform.used = false;
+    }
+
+    // Bound to an ephemeral port: Inform responses come back here
+    if (!m_socket->bind(QHostAddress::AnyIPv4, 0)) {
+        qWarning() << "Notification socket bind failed:" << m_socket->errorString();
+    }
+    connect(m_socket, &QUdpSocket::readyRead, this, &SnmpNotifier::readResponses);
+
+    m_retransmitTimer.setSingleShot(true);
+    connect(&m_retransmitTimer, &QTimer::timeout, this, &SnmpNotifier::retransmit);
+    connect(&m_collapseTimer, &QTimer::timeout, this, &SnmpNotifier::flushCollapsed);
+}
+
+void SnmpNotifier::setTarget(const QHostAddress &address, quint16 port, const QString &community, NotifyType type) {
+    m_address = address;
+    m_port = port;
+    m_community = community.toLatin1();
+    m_type = type;
+    m_pdu.setHeader(community, type == NotifyType::TrapV1 ? SNMP_VERSION_1 : SNMP_VERSION_2C);
+    qDebug() << "SNMP notifications to" << address.toString() << ":" << port << "as"
+             << (type == NotifyType::TrapV1 ? "v1 trap" : type == NotifyType::TrapV2 ? "v2c trap" : "v2c inform");
+}
+
+void SnmpNotifier::setRateLimit(int perSecond, int burst) {
+    m_rate = perSecond > 0 ? perSecond : 0;
+    m_burst = burst > 0 ? burst : 1;
+    for (TokenBucket &bucket : m_buckets) {
+        bucket.tokens = m_burst;
+    }
+    if (m_rate > 0) {
+        m_collapseTimer.setInterval(static_cast<int>(std::ceil(1000.0 / m_rate)));
+    }
+}
+
+void SnmpNotifier::setInformRetry(int timeoutMs, int retries) {
+    m_informTimeoutMs = timeoutMs > 0 ? timeoutMs : DEFAULT_INFORM_TIMEOUT_MS;
+    m_informRetries = retries >= 0 ? retries : 0;
+}
+
+NotifyType SnmpNotifier::typeFromString(const QString &name, bool *ok) {
+    if (ok) *ok = true;
+    if (name.compare("v1", Qt::CaseInsensitive) == 0) return NotifyType::TrapV1;
+    if (name.compare("v2c", Qt::CaseInsensitive) == 0) return NotifyType::TrapV2;
+    if (name.compare("inform", Qt::CaseInsensitive) == 0) return NotifyType::Inform;
+    if (ok) *ok = false;
+    return NotifyType::TrapV2;
+}
+
+bool SnmpNotifier::takeToken(TokenBucket &bucket, qint64 nowMs) {
+    if (m_rate <= 0) {
+        return true;
+    }
+    bucket.tokens += (nowMs - bucket.updatedMs) * m_rate / 1000.0;
+    if (bucket.tokens > m_burst) {
+        bucket.tokens = m_burst;
+    }
+    bucket.updatedMs = nowMs;
+    if (bucket.tokens < 1.0) {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+void SnmpNotifier::notify(uint8_t src, const SnmpOid &oid, const SnmpValue &value) {
+    ++m_events;
+    TokenBucket &bucket = m_buckets[src & 0x0F];
+    if (bucket.collapsedCount > 0 || !takeToken(bucket, m_clock.elapsed())) {
+        // Out of tokens: remember the OID, flushCollapsed() sends its value later
+        ++m_rateLimited;
+        for (int i = 0; i < bucket.collapsedCount; ++i) {
+            if (snmpOidCompare(bucket.collapsed[i], oid) == 0) {
+                return;
+            }
+        }
+        if (bucket.collapsedCount < MAX_COLLAPSED) {
+            bucket.collapsed[bucket.collapsedCount++] = oid;
+        }
+        if (!m_collapseTimer.isActive() && m_rate > 0) {
+            m_collapseTimer.start();
+        }
+        LOG_DEBUG(LOG_SNMP, "Notification from source {} rate limited, {} objects pending", src & 0x0F, bucket.collapsedCount);
+        return;
+    }
+
+    beginMessage();
+    m_pdu.add(oid, value);
+    sendMessage();
+}
+
+void SnmpNotifier::flushCollapsed() {
+    qint64 now = m_clock.elapsed();
+    bool waiting = false;
+    for (int src = 0; src < SOURCE_COUNT; ++src) {
+        TokenBucket &bucket = m_buckets[src];
+        if (bucket.collapsedCount == 0) {
+            continue;
+        }
+        if (!takeToken(bucket, now)) {
+            waiting = true;
+            continue;
+        }
+        // One notification with the current value of everything that changed meanwhile
+        beginMessage();
+        for (int i = 0; i < bucket.collapsedCount; ++i) {
+            const OidStore::Entry *entry = m_store->find(bucket.collapsed[i]);
+            if (entry) {
+                m_pdu.add(entry->oid, entry->value());
+            }
+        }
+        LOG_DEBUG(LOG_SNMP, "Sending {} collapsed alarm objects of source {}", bucket.collapsedCount, src);
+        bucket.collapsedCount = 0;
+        sendMessage();
+    }
+    if (!waiting) {
+        m_collapseTimer.stop();
+    }
+}
+
+void SnmpNotifier::beginMessage() {
+    m_pdu.clear();
+    if (m_type != NotifyType::TrapV1) {
+        m_pdu.add(OID_SYS_UPTIME, SnmpValue::timeTicks(static_cast<uint32_t>(m_clock.elapsed() / 10)));
+        m_pdu.add(OID_SNMP_TRAP_OID, SnmpValue::objectId(OID_ALARM_NOTIFICATION));
+    }
+}
+
+void SnmpNotifier::sendMessage() {
+    uint32_t requestId = m_requestId++;
+    bool built;
+    if (m_type == NotifyType::TrapV1) {
+        // generic-trap 6: enterpriseSpecific
+        built = m_pdu.buildTrapV1(OID_ENTERPRISE, m_agentAddress, 6, SNMP_TRAP_ALARM, static_cast<uint32_t>(m_clock.elapsed() / 10));
+    } else {
+        built = m_pdu.build(requestId, m_type == NotifyType::Inform ? SnmpPduBuilder::INFORM_REQUEST : SnmpPduBuilder::TRAP_V2);
+    }
+    if (!built) {
+        emit errorOccurred("SNMP notification does not fit into the encode buffer");
+        return;
+    }
+    sendDatagram(m_pdu.data(), m_pdu.size());
+
+    if (m_type != NotifyType::Inform || m_pdu.size() > SnmpPduBuilder::DEFAULT_MAX_SIZE) {
+        return;
+    }
+    // Keep a copy for retransmission; when all slots are busy the oldest inform is given up
+    PendingInform *slot = nullptr;
+    for (PendingInform &inform : m_pending) {
+        if (!inform.used) {
+            slot = &inform;
+            break;
+        }
+        if (!slot || inform.requestId < slot->requestId) {
+            slot = &inform;
+        }
+    }
+    if (slot->used) {
+        ++m_informsFailed;
+        LOG_WARNING(LOG_SNMP, "Too many unacknowledged informs, giving up request {}", slot->requestId);
+    }
+    slot->used = true;
+    slot->requestId = requestId;
+    slot->attempts = 1;
+    slot->timeoutMs = m_informTimeoutMs;
+    slot->deadlineMs = m_clock.elapsed() + m_informTimeoutMs;
+    slot->size = m_pdu.size();
+    memcpy(slot->data, m_pdu.data(), m_pdu.size());
+    scheduleRetransmit();
+}
+
+void SnmpNotifier::sendDatagram(const char *data, int size) {
+    if (m_socket->writeDatagram(data, size, m_address, m_port) == -1) {
+        QString err = "SNMP notification send failed: " + m_socket->errorString();
+        qWarning() << err;
+        emit errorOccurred(err);
+        return;
+    }
+    ++m_sent;
+    LOG_TRACE(LOG_SNMP, "SNMP notification sent to {}:{} : {}", m_address.toString(), m_port, logHex(data, size));
+}
+
+void SnmpNotifier::retransmit() {
+    qint64 now = m_clock.elapsed();
+    for (PendingInform &inform : m_pending) {
+        if (!inform.used || inform.deadlineMs > now) {
+            continue;
+        }
+        if (inform.attempts > m_informRetries) {
+            inform.used = false;
+            ++m_informsFailed;
+            LOG_WARNING(LOG_SNMP, "Inform {} not acknowledged after {} attempts", inform.requestId, inform.attempts);
+            continue;
+        }
+        // Exponential backoff
+        ++inform.attempts;
+        inform.timeoutMs *= 2;
+        inform.deadlineMs = now + inform.timeoutMs;
+        ++m_informsRetransmitted;
+        sendDatagram(inform.data, inform.size);
+    }
+    scheduleRetransmit();
+}
+
+void SnmpNotifier::scheduleRetransmit() {
+    qint64 nearest = -1;
+    for (const PendingInform &inform : m_pending) {
+        if (inform.used && (nearest < 0 || inform.deadlineMs < nearest)) {
+            nearest = inform.deadlineMs;
+        }
+    }
+    if (nearest < 0) {
+        m_retransmitTimer.stop();
+        return;
+    }
+    qint64 delay = nearest - m_clock.elapsed();
+    m_retransmitTimer.start(delay > 0 ? static_cast<int>(delay) : 0);
+}
+
+void SnmpNotifier::readResponses() {
+    while (m_socket->hasPendingDatagrams()) {
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        qint64 size = m_socket->readDatagram(reinterpret_cast<char*>(m_response), sizeof(m_response), &sender, &senderPort);
+        if (size <= 0) {
+            continue;
+        }
+        // Only the inform target can acknowledge, not anyone who guesses a request-id
+        if (senderPort != m_port || !sender.isEqual(m_address, QHostAddress::TolerantConversion)) {
+            LOG_DEBUG(LOG_SNMP, "Ignoring datagram from a host that is not the notification target");
+            continue;
+        }
+        // Message: SEQUENCE { version, community, Response-PDU { request-id, ... } }
+        BerReader reader(m_response, static_cast<int>(size));
+        BerReader message;
+        BerReader pdu;
+        int32_t version;
+        const uint8_t *community;
+        int communityLength;
+        int32_t requestId;
+        if (!reader.enter(BER_SEQUENCE, message) || !message.readInteger(version)
+            || !message.readOctetString(community, communityLength)
+            || !message.enter(SnmpPduBuilder::GET_RESPONSE, pdu) || !pdu.readInteger(requestId)) {
+            LOG_DEBUG(LOG_SNMP, "Ignoring malformed datagram on the notification socket");
+            continue;
+        }
+        if (communityLength != m_community.size() || memcmp(community, m_community.constData(), communityLength) != 0) {
+            LOG_DEBUG(LOG_SNMP, "Ignoring Response with another community on the notification socket");
+            continue;
+        }
+        for (PendingInform &inform : m_pending) {
+            if (inform.used && inform.requestId == static_cast<uint32_t>(requestId)) {
+                inform.used = false;
+                ++m_informsAcked;
+                LOG_DEBUG(LOG_SNMP, "Inform {} acknowledged after {} attempts", inform.requestId, inform.attempts);
+                break;
+            }
+        }
+    }
+    scheduleRetransmit();
+}
@@ -0,0 +1,134 @@
+#ifndef SNMPNOTIFIER_H
+#define SNMPNOTIFIER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "oidstore.h"
+#include "snmppdu.h"
+
+// Notification PDU sent on an alarm edge
+enum class NotifyType {
+    TrapV1,  // SNMPv1 Trap-PDU
+    TrapV2,  // SNMPv2c Trap
+    Inform   // SNMPv2c InformRequest, retransmitted until acknowledged
+};
+
+/*
+Sends SNMP notifications for alarm state changes (SnmpConverter detects the edge).
+One notification carries the changed alarm object (enterprise-specific trap
+SNMP_TRAP_ALARM; v2c adds sysUpTime.0 and snmpTrapOID.0 in front).
+Informs wait for a Response with the same request-id; without one they are
+resent after timeout, 2*timeout, 4*timeout ... up to retries times.
+Every SCI source has a token bucket (rate per second, burst). An event
+without a token is not lost: its OID is remembered and when the bucket
+refills one notification carries the current values of all OIDs that
+changed in the meantime, so a flapping unit costs at most `rate` messages
+per second. Pending informs and collapsed OIDs live in fixed arrays.
+*/
+class SnmpNotifier : public QObject {
+    Q_OBJECT
+public:
+    static const int DEFAULT_RATE = 1;   // Notifications per second per source
+    static const int DEFAULT_BURST = 5;
+    static const int DEFAULT_INFORM_TIMEOUT_MS = 1000;
+    static const int DEFAULT_INFORM_RETRIES = 3;
+
+    explicit SnmpNotifier(const OidStore *store, QObject *parent = nullptr);
+
+    // Receiver, community and PDU type (Inform/TrapV2 force version 2c, TrapV1 version 1)
+    void setTarget(const QHostAddress &address, quint16 port, const QString &community, NotifyType type);
+    // Trap-PDU agent-addr (v1 only)
+    void setAgentAddress(const QHostAddress &address) { m_agentAddress = address.toIPv4Address(); }
+    // Per-source token bucket, rate 0 disables rate limiting
+    void setRateLimit(int perSecond, int burst);
+    void setInformRetry(int timeoutMs, int retries);
+    // "v1", "v2c", "inform"
+    static NotifyType typeFromString(const QString &name, bool *ok = nullptr);
+
+    // Alarm object changed on SCI source src (converter thread)
+    void notify(uint8_t src, const SnmpOid &oid, const SnmpValue &value);
+
+    // Statistics
+    uint64_t events() const { return m_events; }
+    uint64_t sent() const { return m_sent; }
+    uint64_t rateLimited() const { return m_rateLimited; }
+    uint64_t informsAcked() const { return m_informsAcked; }
+    uint64_t informsRetransmitted() const { return m_informsRetransmitted; }
+    uint64_t informsFailed() const { return m_informsFailed; }
+
+signals:
+    void errorOccurred(const QString &err);
+
+private slots:
+    void readResponses();
+    void retransmit();
+    void flushCollapsed();
+
+private:
+    // Number of SCI addresses (4-bit source field)
+    static const int SOURCE_COUNT = 16;
+    // Distinct OIDs remembered per source while it is rate limited
+    static const int MAX_COLLAPSED = 16;
+    static const int MAX_PENDING_INFORMS = 32;
+
+    struct TokenBucket {
+        double tokens;
+        qint64 updatedMs;
+        SnmpOid collapsed[MAX_COLLAPSED]; // Changed while out of tokens, values are read from the store
+        int collapsedCount;
+    };
+
+    struct PendingInform {
+        bool used;
+        uint32_t requestId;
+        int attempts;
+        int timeoutMs;
+        qint64 deadlineMs;
+        int size;
+        char data[SnmpPduBuilder::DEFAULT_MAX_SIZE];
+    };
+
+    const OidStore *m_store;
+    QUdpSocket *m_socket;
+    QHostAddress m_address;
+    quint16 m_port = 162;
+    QByteArray m_community;       // Expected in the Response to an inform
+    NotifyType m_type = NotifyType::TrapV2;
+    uint32_t m_agentAddress = 0;
+    uint32_t m_requestId = 1;
+    SnmpPduBuilder m_pdu;
+    QElapsedTimer m_clock;        // sysUpTime and all deadlines
+    uint8_t m_response[SnmpPduBuilder::MAX_MESSAGE_SIZE];
+
+    double m_rate = DEFAULT_RATE;
+    int m_burst = DEFAULT_BURST;
+    TokenBucket m_buckets[SOURCE_COUNT];
+    QTimer m_collapseTimer;
+
+    int m_informTimeoutMs = DEFAULT_INFORM_TIMEOUT_MS;
+    int m_informRetries = DEFAULT_INFORM_RETRIES;
+    PendingInform m_pending[MAX_PENDING_INFORMS];
+    QTimer m_retransmitTimer;
+
+    uint64_t m_events = 0;
+    uint64_t m_sent = 0;
+    uint64_t m_rateLimited = 0;
+    uint64_t m_informsAcked = 0;
+    uint64_t m_informsRetransmitted = 0;
+    uint64_t m_informsFailed = 0;
+
+    // Take a token of the source bucket
+    bool takeToken(TokenBucket &bucket, qint64 nowMs);
+    // Start a notification: v2c sysUpTime.0 and snmpTrapOID.0
+    void beginMessage();
+    // Encode what was added to m_pdu and send it
+    void sendMessage();
+    void sendDatagram(const char *data, int size);
+    // Arm m_retransmitTimer for the nearest inform deadline
+    void scheduleRetransmit();
+};
+
+#endif // SNMPNOTIFIER_H
@@ -0,0 +1,151 @@
+#ifndef SNMPOIDS_H
+#define SNMPOIDS_H
+
+#include <cstdint>
+
+/*
+OID table of the MIB (enterprise 1.3.6.1.4.1.58039).
+All OIDs are BER-encoded at compile time, so building a varbind is a table lookup
+followed by a copy of a few bytes: no hex strings, no heap.
+*/
+
+// Maximum length of an encoded OID: table entries and OIDs received in agent requests
+const int SNMP_OID_MAX_LENGTH = 32;
+
+// BER-encoded OID contents (without tag and length bytes)
+struct SnmpOid {
+    uint8_t length;
+    uint8_t bytes[SNMP_OID_MAX_LENGTH];
+};
+
+/*
+Compare two encoded OIDs arc by arc (lexicographic order of the decoded sub-identifiers,
+the order of GETNEXT walks). Plain byte comparison is not enough: 0x81 0x00 (128) > 0x7F (127)
+Return: <0, 0, >0
+*/
+inline int snmpOidCompare(const SnmpOid &a, const SnmpOid &b) {
+    int i = 0;
+    int j = 0;
+    while (i < a.length && j < b.length) {
+        // Decode the next sub-identifier of each OID
+        uint32_t arcA = 0;
+        uint32_t arcB = 0;
+        do { arcA = (arcA << 7) | (a.bytes[i] & 0x7F); } while ((a.bytes[i++] & 0x80) && i < a.length);
+        do { arcB = (arcB << 7) | (b.bytes[j] & 0x7F); } while ((b.bytes[j++] & 0x80) && j < b.length);
+        if (arcA != arcB) {
+            return arcA < arcB ? -1 : 1;
+        }
+    }
+    if (i < a.length) return 1;  // a is longer: b is its prefix
+    if (j < b.length) return -1;
+    return 0;
+}
+
+// MIB subtrees under 1.3.6.1.4.1.58039
+enum MibGroup : uint8_t {
+    MIB_PRODUCT = 1,
+    MIB_INFO = 2,
+    MIB_CONFIG = 3,
+    MIB_UNITQUERY = 4,
+    MIB_METRICS = 5 // Converter's own counters and latencies (MetricsServer)
+};
+
+/*
+Build 1.3.6.1.4.1.58039.<group>.<index>
+Prefix bytes 2B 06 01 04 01 E2 F7 are kept exactly as earlier versions sent them.
+Group and index are below 128, so each takes one byte.
+*/
+constexpr SnmpOid makeMibOid(uint8_t group, uint8_t index) {
+    return SnmpOid{9, {0x2B, 0x06, 0x01, 0x04, 0x01, 0xE2, 0xF7, group, index}};
+}
+
+// Per-unit parameters of unitquery
+enum UnitParam {
+    PARAM_STATUS,
+    PARAM_POWER,
+    PARAM_REFLECTED_POWER,
+    PARAM_TEMPERATURE,
+    PARAM_INPUT_VOLTAGE,
+    PARAM_GAIN,
+    PARAM_MUTE,
+    PARAM_OPERATING_IF,
+    PARAM_SUMMARY_ALARM,
+    PARAM_OUT_OF_LOCK_ALARM,
+    PARAM_TEMP_ALARM,
+    PARAM_INPUT_VOLTAGE_ALARM,
+    PARAM_OVER_POWER_ALARM,
+    PARAM_ALARM_LOG1,
+    PARAM_ALARM_LOG2,
+    PARAM_ALARM_LOG3,
+    UNIT_PARAM_COUNT
+};
+
+// Number of PA units on the bus (A, B, C)
+const int SCI_UNIT_COUNT = 3;
+
+/*
+Map SCI source address to the unit index
+Return: 0 for PA A (0xA), 1 for PA B (0xB), 2 for PA C (0xC), -1 for other sources
+*/
+constexpr int sciUnitIndex(uint8_t src) {
+    return (src >= 0xA && src <= 0xC) ? src - 0xA : -1;
+}
+
+// unitquery.<N> index of every parameter for PA A, PA B and PA C
+constexpr uint8_t UNITQUERY_INDEX[SCI_UNIT_COUNT][UNIT_PARAM_COUNT] = {
+    // status power refl temp  volt  gain  mute  IF    summ  lock  tAlm  vAlm  pAlm  log1  log2  log3
+    {  1,     3,    4,   5,    6,    7,    8,    9,    10,   11,   12,   13,   14,   62,   63,   64 }, // PA A
+    {  2,     20,   21,  22,   23,   24,   25,   26,   27,   28,   29,   30,   31,   65,   66,   67 }, // PA B
+    {  40,    41,   42,  43,   44,   45,   46,   47,   48,   49,   50,   51,   52,   74,   75,   76 }  // PA C
+};
+
+struct UnitOidTable {
+    SnmpOid oid[SCI_UNIT_COUNT][UNIT_PARAM_COUNT];
+};
+
+constexpr UnitOidTable buildUnitOidTable() {
+    UnitOidTable table{};
+    for (int unit = 0; unit < SCI_UNIT_COUNT; ++unit) {
+        for (int param = 0; param < UNIT_PARAM_COUNT; ++param) {
+            table.oid[unit][param] = makeMibOid(MIB_UNITQUERY, UNITQUERY_INDEX[unit][param]);
+        }
+    }
+    return table;
+}
+
+// Encoded OIDs indexed by [sciUnitIndex(src)][UnitParam]
+inline constexpr UnitOidTable UNIT_OIDS = buildUnitOidTable();
+
+// Unit-independent objects
+inline constexpr SnmpOid OID_PRODUCT_NAME = makeMibOid(MIB_PRODUCT, 1);       // product.name
+inline constexpr SnmpOid OID_PRODUCT_VERSION = makeMibOid(MIB_PRODUCT, 2);    // product.version
+inline constexpr SnmpOid OID_UNIT_TYPE = makeMibOid(MIB_INFO, 1);             // info.unitType
+inline constexpr SnmpOid OID_OP_MODE = makeMibOid(MIB_INFO, 2);               // info.opMode
+inline constexpr SnmpOid OID_UPLINK_CHAIN = makeMibOid(MIB_CONFIG, 6);        // config.uplinkChain
+inline constexpr SnmpOid OID_UP_SWITCH_ALARM = makeMibOid(MIB_UNITQUERY, 60); // unitquery.upSwitchAlarm
+inline constexpr SnmpOid OID_UP_SWITCH2_ALARM = makeMibOid(MIB_UNITQUERY, 61);// unitquery.upSwitch2Alarm
+
+// info.paAVer / paBVer / paCVer indexed by unit
+inline constexpr SnmpOid PA_FIRMWARE_OIDS[SCI_UNIT_COUNT] = {
+    makeMibOid(MIB_INFO, 4), makeMibOid(MIB_INFO, 5), makeMibOid(MIB_INFO, 6)
+};
+
+// unitquery.switchAlarmLog1-3
+inline constexpr SnmpOid SWITCH_ALARM_LOG_OIDS[3] = {
+    makeMibOid(MIB_UNITQUERY, 68), makeMibOid(MIB_UNITQUERY, 69), makeMibOid(MIB_UNITQUERY, 70)
+};
+
+/*
+Notifications.
+The enterprise arc 58039 is encoded properly here (83 C5 37): the legacy prefix of
+makeMibOid() only forms a complete OID together with the group byte, so it cannot
+serve as the Trap-PDU enterprise or the base of snmpTrapOID values.
+*/
+inline constexpr SnmpOid OID_ENTERPRISE = {8, {0x2B, 0x06, 0x01, 0x04, 0x01, 0x83, 0xC5, 0x37}}; // 1.3.6.1.4.1.58039
+inline constexpr SnmpOid OID_SYS_UPTIME = {8, {0x2B, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00}}; // sysUpTime.0
+inline constexpr SnmpOid OID_SNMP_TRAP_OID = {10, {0x2B, 0x06, 0x01, 0x06, 0x03, 0x01, 0x01, 0x04, 0x01, 0x00}}; // snmpTrapOID.0
+// enterpriseSpecific trap numbers; SNMPv2 trap OID is <enterprise>.0.<number> (RFC 3584)
+const int SNMP_TRAP_ALARM = 1;
+inline constexpr SnmpOid OID_ALARM_NOTIFICATION = {10, {0x2B, 0x06, 0x01, 0x04, 0x01, 0x83, 0xC5, 0x37, 0x00, SNMP_TRAP_ALARM}};
+
+#endif // SNMPOIDS_H
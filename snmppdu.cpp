@@ -0,0 +1,165 @@
+#include "snmppdu.h"
+
+SnmpPduBuilder::SnmpPduBuilder(const QString &community, int version, int maxSize) {
+    setHeader(community, version);
+    setMaxSize(maxSize);
+}
+
+void SnmpHeader::encode(const QString &community, int version) {
+    QByteArray latin1 = community.toLatin1();
+    encode(latin1.constData(), latin1.size(), version);
+}
+
+void SnmpHeader::encode(const char *community, int length, int version) {
+    if (length > MAX_COMMUNITY_LENGTH) {
+        length = MAX_COMMUNITY_LENGTH;
+    }
+
+    BerWriter w(bytes, sizeof(bytes));
+    w.writeOctetString(community, length);
+    w.writeInteger(version);
+
+    // Header is written at the end of bytes, move it to the front
+    size = w.length();
+    const uint8_t *header = w.data();
+    for (int i = 0; i < size; ++i) {
+        bytes[i] = header[i];
+    }
+    this->version = version;
+    communityLength = length;
+}
+
+void SnmpPduBuilder::setHeader(const QString &community, int version) {
+    m_header.encode(community, version);
+}
+
+void SnmpPduBuilder::setHeader(const char *community, int communityLength, int version) {
+    m_header.encode(community, communityLength, version);
+}
+
+void SnmpPduBuilder::setMaxSize(int maxSize) {
+    m_maxSize = maxSize > MAX_MESSAGE_SIZE ? MAX_MESSAGE_SIZE : maxSize;
+}
+
+bool SnmpPduBuilder::add(const SnmpOid &oid, const SnmpValue &value) {
+    // VarBind: SEQUENCE { OID, value }
+    int varbindSize = berTlvSize(berTlvSize(oid.length) + value.encodedSize());
+    if (m_varbindCount == MAX_VARBINDS
+        || (m_varbindCount > 0 && messageSize(m_varbindsLength + varbindSize) > m_maxSize)) {
+        return false; // Does not fit, caller has to send the current message first
+    }
+
+    Varbind &varbind = m_varbinds[m_varbindCount];
+    varbind.oid = oid;
+    varbind.value = value;
+    if (value.type == BER_OCTET_STRING || value.type == BER_OID) {
+        // The first varbind skips the size check above, so guard the arena here
+        int length = value.length;
+        if (length > MAX_MESSAGE_SIZE - m_stringsLength) {
+            return false;
+        }
+        char *copy = m_strings + m_stringsLength;
+        for (int i = 0; i < length; ++i) {
+            copy[i] = value.string[i];
+        }
+        varbind.value.string = copy;
+        m_stringsLength += length;
+    }
+
+    ++m_varbindCount;
+    m_varbindsLength += varbindSize;
+    return true;
+}
+
+bool SnmpPduBuilder::build(uint32_t requestId, uint8_t pduType, int errorStatus, int errorIndex) {
+    BerWriter w(m_buffer, sizeof(m_buffer));
+
+    // Every constructed element below (VarBindList, PDU, message) ends where the buffer ends
+    int end = w.length();
+    writeVarbinds(w);
+
+    // PDU: request-id, error-status, error-index, VarBindList
+    w.writeInteger(errorIndex);
+    w.writeInteger(errorStatus);
+    w.writeInteger(static_cast<int32_t>(requestId));
+    w.closeConstructed(pduType, end);
+    return finish(w, end);
+}
+
+bool SnmpPduBuilder::buildTrapV1(const SnmpOid &enterprise, uint32_t agentAddress, int genericTrap, int specificTrap, uint32_t timeStamp) {
+    BerWriter w(m_buffer, sizeof(m_buffer));
+    int end = w.length();
+    writeVarbinds(w);
+
+    // Trap-PDU: enterprise, agent-addr, generic-trap, specific-trap, time-stamp, VarBindList
+    w.writeTimeTicks(timeStamp);
+    w.writeInteger(specificTrap);
+    w.writeInteger(genericTrap);
+    SnmpValue::ipAddress(agentAddress).encode(w);
+    w.writeOid(enterprise);
+    w.closeConstructed(TRAP_V1, end);
+    return finish(w, end);
+}
+
+void SnmpPduBuilder::writeVarbinds(BerWriter &w) const {
+    // Last varbind first
+    int end = w.length();
+    for (int i = m_varbindCount - 1; i >= 0; --i) {
+        const Varbind &varbind = m_varbinds[i];
+        int varbindMark = w.length();
+        varbind.value.encode(w);
+        w.writeOid(varbind.oid);
+        w.closeConstructed(BER_SEQUENCE, varbindMark);
+    }
+    w.closeConstructed(BER_SEQUENCE, end);
+}
+
+bool SnmpPduBuilder::finish(BerWriter &w, int end) {
+    m_pduSize = w.length() - end;
+    // Message: version, community (pre-encoded), PDU
+    w.writeBytes(m_header.bytes, m_header.size);
+    w.closeConstructed(BER_SEQUENCE, end);
+
+    clear();
+    if (w.overflow()) {
+        m_messageSize = 0;
+        m_pduSize = 0;
+        return false;
+    }
+    m_messageOffset = sizeof(m_buffer) - w.length();
+    m_messageSize = w.length();
+    return true;
+}
+
+int SnmpPduBuilder::messagePrefix(const SnmpHeader &header, char *prefix) const {
+    // SEQUENCE tag and definite length of header + PDU, written forwards
+    int contentLength = header.size + m_pduSize;
+    int lengthSize = berLengthSize(contentLength);
+    int n = 0;
+    prefix[n++] = static_cast<char>(BER_SEQUENCE);
+    if (lengthSize == 1) {
+        prefix[n++] = static_cast<char>(contentLength);
+    } else {
+        prefix[n++] = static_cast<char>(0x80 | (lengthSize - 1));
+        for (int i = lengthSize - 2; i >= 0; --i) {
+            prefix[n++] = static_cast<char>((contentLength >> (8 * i)) & 0xFF);
+        }
+    }
+    for (int i = 0; i < header.size; ++i) {
+        prefix[n++] = static_cast<char>(header.bytes[i]);
+    }
+    return n;
+}
+
+void SnmpPduBuilder::clear() {
+    m_varbindCount = 0;
+    m_varbindsLength = 0;
+    m_stringsLength = 0;
+}
+
+int SnmpPduBuilder::messageSize(int varbindsLength) const {
+    // request-id takes at most 4 content bytes, error-status and error-index one each (index < 128)
+    int pduSize = berTlvSize(4) + berTlvSize(1) + berTlvSize(1) + berTlvSize(varbindsLength);
+    int contentSize = m_header.size + berTlvSize(pduSize);
+    return berTlvSize(contentSize);
+}
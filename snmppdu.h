@@ -0,0 +1,143 @@
+#ifndef SNMPPDU_H
+#define SNMPPDU_H
+
+#include <QString>
+#include "ber.h"
+#include "snmpoids.h"
+#include "snmpvalue.h"
+
+// SNMP message versions
+const int SNMP_VERSION_1 = 0;
+const int SNMP_VERSION_2C = 1;
+
+// Pre-encoded version INTEGER + community OCTET STRING, the part of a message that differs per destination
+struct SnmpHeader {
+    static const int MAX_COMMUNITY_LENGTH = 64;
+    uint8_t bytes[3 + 2 + MAX_COMMUNITY_LENGTH];
+    int size = 0;
+    int version = SNMP_VERSION_1;
+    int communityLength = 0;
+
+    // Longer communities are truncated to MAX_COMMUNITY_LENGTH
+    void encode(const char *community, int length, int version);
+    void encode(const QString &community, int version);
+};
+
+/*
+Single place where SNMP messages are built.
+Collects varbinds of one SCI frame and builds a single message with all of
+them (GetResponse-PDU by default), instead of one datagram per value.
+Message size is limited by maxSize (UDP payload that fits into the MTU);
+when the next varbind does not fit, add() returns false and the caller
+sends what was collected and starts a new message.
+Varbinds are kept in a fixed array (strings in a fixed arena), the version
+and community are encoded once, and the message is encoded backwards with
+BerWriter into a member buffer: building a message does not allocate.
+*/
+class SnmpPduBuilder {
+public:
+    // 1500 bytes Ethernet MTU - 20 bytes IPv4 header - 8 bytes UDP header
+    static const int DEFAULT_MAX_SIZE = 1472;
+    // Size of the encode buffer, upper bound for maxSize
+    static const int MAX_MESSAGE_SIZE = 8192;
+    // Upper bound for varbinds in one message
+    static const int MAX_VARBINDS = 64;
+    // Longest community string
+    static const int MAX_COMMUNITY_LENGTH = SnmpHeader::MAX_COMMUNITY_LENGTH;
+    // PDU tags
+    static const uint8_t GET_REQUEST = 0xA0;
+    static const uint8_t GET_NEXT_REQUEST = 0xA1;
+    static const uint8_t GET_RESPONSE = 0xA2;
+    static const uint8_t SET_REQUEST = 0xA3;
+    static const uint8_t TRAP_V1 = 0xA4;
+    static const uint8_t GET_BULK_REQUEST = 0xA5;
+    static const uint8_t INFORM_REQUEST = 0xA6;
+    static const uint8_t TRAP_V2 = 0xA7;
+    // error-status values
+    static const int NO_ERROR = 0;
+    static const int TOO_BIG = 1;
+    static const int NO_SUCH_NAME = 2;
+    static const int BAD_VALUE = 3;
+    static const int GEN_ERR = 5;
+    // v2c only (RFC 3416)
+    static const int WRONG_TYPE = 7;
+    static const int WRONG_VALUE = 10;
+    static const int RESOURCE_UNAVAILABLE = 13;
+    static const int COMMIT_FAILED = 14;
+    static const int NOT_WRITABLE = 17;
+
+    explicit SnmpPduBuilder(const QString &community = "public", int version = SNMP_VERSION_1, int maxSize = DEFAULT_MAX_SIZE);
+
+    // Encode version and community once, they start every message
+    void setHeader(const QString &community, int version = SNMP_VERSION_1);
+    // Same from raw bytes (community of a received request), no allocation
+    void setHeader(const char *community, int communityLength, int version);
+    int version() const { return m_header.version; }
+    // Community length of the header in use (maxSize checks assume it)
+    int communityLength() const { return m_header.communityLength; }
+    void setMaxSize(int maxSize);
+    int maxSize() const { return m_maxSize; }
+    bool isEmpty() const { return m_varbindCount == 0; }
+    int varbindCount() const { return m_varbindCount; }
+
+    /*
+    Append varbind, OCTET STRING contents are copied
+    Return: false if the message would exceed maxSize (nothing is appended)
+    */
+    bool add(const SnmpOid &oid, const SnmpValue &value);
+    /*
+    Encode the message with all collected varbinds and start a new one
+    Return: false if encoding failed (message does not fit into the buffer)
+    Encoded message is available via data()/size() until the next build()
+    */
+    bool build(uint32_t requestId, uint8_t pduType = GET_RESPONSE, int errorStatus = NO_ERROR, int errorIndex = 0);
+    /*
+    Same with an SNMPv1 Trap-PDU (version must be SNMP_VERSION_1).
+    Its fixed fields are about 20 bytes longer than request-id/error fields,
+    add() does not account for that: keep traps well below maxSize
+    */
+    bool buildTrapV1(const SnmpOid &enterprise, uint32_t agentAddress, int genericTrap, int specificTrap, uint32_t timeStamp);
+    const char *data() const { return reinterpret_cast<const char*>(m_buffer + m_messageOffset); }
+    int size() const { return m_messageSize; }
+    /*
+    The PDU alone (last element of the message), to be sent with other headers:
+    prefix = messagePrefix(header), datagram = prefix + pduData()
+    */
+    const char *pduData() const { return reinterpret_cast<const char*>(m_buffer + sizeof(m_buffer) - m_pduSize); }
+    int pduSize() const { return m_pduSize; }
+    // Maximum size of a messagePrefix()
+    static const int MAX_PREFIX_SIZE = 1 + 5 + sizeof(SnmpHeader::bytes);
+    // Message SEQUENCE tag/length and the header for the last built PDU; returns the prefix size
+    int messagePrefix(const SnmpHeader &header, char *prefix) const;
+    // Drop collected varbinds
+    void clear();
+
+private:
+    struct Varbind {
+        SnmpOid oid;
+        SnmpValue value; // value.string points into m_strings
+    };
+
+    SnmpHeader m_header;
+    int m_maxSize;
+
+    Varbind m_varbinds[MAX_VARBINDS];
+    int m_varbindCount = 0;
+    int m_varbindsLength = 0; // Encoded size of all VarBind sequences
+    char m_strings[MAX_MESSAGE_SIZE]; // OCTET STRING contents of the collected varbinds
+    int m_stringsLength = 0;
+
+    uint8_t m_buffer[MAX_MESSAGE_SIZE];
+    int m_messageOffset = 0;
+    int m_messageSize = 0;
+    int m_pduSize = 0; // PDU TLV at the end of m_buffer
+
+    // VarBindList of the collected varbinds
+    void writeVarbinds(BerWriter &w) const;
+    // Prepend version/community, close the message opened at end and start a new one
+    bool finish(BerWriter &w, int end);
+    // Size of the whole message for the given VarBindList contents length
+    int messageSize(int varbindsLength) const;
+};
+
+#endif // SNMPPDU_H
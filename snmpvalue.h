@@ -0,0 +1,88 @@
+#ifndef SNMPVALUE_H
+#define SNMPVALUE_H
+
+#include <cstdint>
+#include "ber.h"
+
+/*
+Typed value of a varbind.
+>type - BER tag (BER_INTEGER, BER_OCTET_STRING, BER_OID, BER_COUNTER32, BER_GAUGE32, BER_TIMETICKS, BER_IP_ADDRESS, BER_NULL)
+>number - INTEGER (two's complement bits) or unsigned value of the application types
+>string/length - OCTET STRING contents or encoded OBJECT IDENTIFIER, not owned: copied by whoever stores the value
+*/
+struct SnmpValue {
+    uint8_t type = BER_NULL;
+    uint32_t number = 0;
+    const char *string = nullptr;
+    int length = 0;
+
+    static SnmpValue integer(int32_t value) { return make(BER_INTEGER, static_cast<uint32_t>(value)); }
+    static SnmpValue counter32(uint32_t value) { return make(BER_COUNTER32, value); }
+    static SnmpValue gauge32(uint32_t value) { return make(BER_GAUGE32, value); }
+    static SnmpValue timeTicks(uint32_t value) { return make(BER_TIMETICKS, value); }
+    static SnmpValue ipAddress(uint32_t address) { return make(BER_IP_ADDRESS, address); }
+    static SnmpValue octetString(const char *bytes, int size) {
+        SnmpValue value;
+        value.type = BER_OCTET_STRING;
+        value.string = bytes;
+        value.length = size;
+        return value;
+    }
+    // OBJECT IDENTIFIER value (snmpTrapOID.0), points into oid
+    static SnmpValue objectId(const SnmpOid &oid) {
+        SnmpValue value;
+        value.type = BER_OID;
+        value.string = reinterpret_cast<const char*>(oid.bytes);
+        value.length = oid.length;
+        return value;
+    }
+
+    int32_t toInteger() const { return static_cast<int32_t>(number); }
+
+    // Size of the encoded TLV
+    int encodedSize() const {
+        switch (type) {
+        case BER_INTEGER: return berTlvSize(berIntegerSize(toInteger()));
+        case BER_OCTET_STRING:
+        case BER_OID: return berTlvSize(length);
+        case BER_IP_ADDRESS: return berTlvSize(4);
+        case BER_COUNTER32:
+        case BER_GAUGE32:
+        case BER_TIMETICKS: return berTlvSize(berUnsignedSize(number));
+        default: return berTlvSize(0);
+        }
+    }
+
+    // Write the value with BerWriter (backwards, see ber.h)
+    void encode(BerWriter &w) const {
+        switch (type) {
+        case BER_INTEGER: w.writeInteger(toInteger()); break;
+        case BER_OCTET_STRING: w.writeOctetString(string, length); break;
+        case BER_OID:
+            w.writeBytes(reinterpret_cast<const uint8_t*>(string), length);
+            w.writeHeader(BER_OID, length);
+            break;
+        case BER_IP_ADDRESS: {
+            const uint8_t bytes[4] = {static_cast<uint8_t>(number >> 24), static_cast<uint8_t>(number >> 16),
+                                      static_cast<uint8_t>(number >> 8), static_cast<uint8_t>(number)};
+            w.writeBytes(bytes, 4);
+            w.writeHeader(BER_IP_ADDRESS, 4);
+            break;
+        }
+        case BER_COUNTER32:
+        case BER_GAUGE32:
+        case BER_TIMETICKS: w.writeUnsigned(type, number); break;
+        default: w.writeHeader(type, 0); break; // NULL and other empty values
+        }
+    }
+
+private:
+    static SnmpValue make(uint8_t type, uint32_t number) {
+        SnmpValue value;
+        value.type = type;
+        value.number = number;
+        return value;
+    }
+};
+
+#endif // SNMPVALUE_H
@@ -0,0 +1,200 @@
+#include "statefile.h"
+#include <QDebug>
+#include <QDateTime>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace {
+const char STATE_MAGIC[8] = {'R', 'S', '4', '8', '5', 'S', 'T', '\0'};
+const uint32_t STATE_VERSION = 1;
+}
+
+static_assert(sizeof(StateFile::Slot) == 88, "State file layout changed: bump STATE_VERSION");
+
+StateFile::StateFile(const QString &fileName, QObject *parent)
+    : QObject(parent), m_file(fileName) {
+    m_index.reserve(MAX_SLOTS);
+    m_free.reserve(MAX_SLOTS);
+    connect(&m_syncTimer, &QTimer::timeout, this, &StateFile::sync);
+    setSyncInterval(DEFAULT_SYNC_INTERVAL_MS);
+}
+
+StateFile::~StateFile() {
+    sync();
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+qint64 StateFile::fileSize() {
+    return HEADER_SIZE + static_cast<qint64>(MAX_SLOTS) * sizeof(Slot);
+}
+
+void StateFile::setSyncInterval(int intervalMs) {
+    if (intervalMs > 0) {
+        m_syncTimer.start(intervalMs);
+    } else {
+        m_syncTimer.stop();
+    }
+}
+
+uint32_t StateFile::checksum(const Slot &slot) {
+    // FNV-1a over everything after the checksum field
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&slot) + offsetof(Slot, updatedMs);
+    int size = sizeof(Slot) - offsetof(Slot, updatedMs);
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool StateFile::open() {
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        emit errorOccurred(QString("Cannot open state file %1: %2").arg(m_file.fileName()).arg(m_file.errorString()));
+        return false;
+    }
+    bool resized = m_file.size() != fileSize();
+    if (resized && !m_file.resize(fileSize())) {
+        emit errorOccurred(QString("Cannot resize state file %1: %2").arg(m_file.fileName()).arg(m_file.errorString()));
+        m_file.close();
+        return false;
+    }
+    m_map = m_file.map(0, fileSize());
+    if (!m_map) {
+        emit errorOccurred(QString("Cannot map state file %1: %2").arg(m_file.fileName()).arg(m_file.errorString()));
+        m_file.close();
+        return false;
+    }
+    m_slots = reinterpret_cast<Slot *>(m_map + HEADER_SIZE);
+
+    Header *header = reinterpret_cast<Header *>(m_map);
+    if (resized || memcmp(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0 || header->version != STATE_VERSION
+        || header->slotSize != sizeof(Slot) || header->slotCount != MAX_SLOTS) {
+        if (!resized) {
+            qWarning() << "State file" << m_file.fileName() << "has another layout, starting empty";
+        }
+        memset(m_map, 0, fileSize());
+        memcpy(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC));
+        header->version = STATE_VERSION;
+        header->slotSize = sizeof(Slot);
+        header->slotCount = MAX_SLOTS;
+        header->createdMs = QDateTime::currentMSecsSinceEpoch();
+        m_dirty = true;
+    }
+
+    m_index.clear();
+    m_free.clear();
+    m_discarded = 0;
+    // Backwards: m_free ends with the lowest slot, taken first, so the used part stays compact
+    for (int i = MAX_SLOTS - 1; i >= 0; --i) {
+        const Slot &slot = m_slots[i];
+        if (slot.oid.length == 0 && slot.sequence == 0) {
+            m_free.push_back(i);
+            continue;
+        }
+        bool valid = (slot.sequence & 1) == 0 && slot.checksum == checksum(slot)
+                     && slot.oid.length > 0 && slot.oid.length <= SNMP_OID_MAX_LENGTH
+                     && slot.length <= OidStore::MAX_STRING_LENGTH;
+        if (!valid) {
+            // Torn write: the slot is reused, its object comes back with the next frame
+            ++m_discarded;
+            m_free.push_back(i);
+            continue;
+        }
+        int position = lowerBound(slot.oid);
+        if (position < size() && snmpOidCompare(m_index[position].oid, slot.oid) == 0) {
+            // Same object twice cannot be written by write(); keep one
+            ++m_discarded;
+            m_free.push_back(i);
+            continue;
+        }
+        m_index.insert(m_index.begin() + position, IndexEntry{slot.oid, i});
+    }
+    if (m_discarded > 0) {
+        qWarning() << "State file" << m_file.fileName() << ":" << m_discarded << "damaged slots skipped";
+    }
+    return true;
+}
+
+int StateFile::lowerBound(const SnmpOid &oid) const {
+    int low = 0;
+    int high = static_cast<int>(m_index.size());
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (snmpOidCompare(m_index[middle].oid, oid) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void StateFile::write(const SnmpOid &oid, const SnmpValue &value) {
+    if (!m_slots) {
+        return;
+    }
+    int length = value.type == BER_OCTET_STRING ? value.length : 0;
+    if (length > OidStore::MAX_STRING_LENGTH) {
+        length = OidStore::MAX_STRING_LENGTH;
+    }
+
+    int position = lowerBound(oid);
+    Slot *slot;
+    if (position < size() && snmpOidCompare(m_index[position].oid, oid) == 0) {
+        slot = &m_slots[m_index[position].slot];
+        if (slot->type == value.type && slot->number == value.number && slot->length == length
+            && (length == 0 || memcmp(slot->text, value.string, length) == 0)) {
+            return; // Unchanged: the page stays clean
+        }
+    } else {
+        if (m_free.empty()) {
+            if (m_dropped++ == 0) {
+                emit errorOccurred(QString("State file %1 is full (%2 objects)").arg(m_file.fileName()).arg(MAX_SLOTS));
+            }
+            return;
+        }
+        int free = m_free.back();
+        m_free.pop_back();
+        m_index.insert(m_index.begin() + position, IndexEntry{oid, free});
+        slot = &m_slots[free];
+    }
+
+    // Odd sequence first, payload and checksum, even sequence last: a crash at
+    // any point leaves either the old slot or one that open() rejects
+    slot->sequence = (slot->sequence + 1) | 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->updatedMs = QDateTime::currentMSecsSinceEpoch();
+    slot->oid = oid;
+    slot->type = value.type;
+    slot->length = static_cast<uint8_t>(length);
+    slot->reserved = 0;
+    slot->number = value.number;
+    if (length > 0) {
+        memcpy(slot->text, value.string, length);
+    }
+    memset(slot->text + length, 0, OidStore::MAX_STRING_LENGTH - length);
+    slot->checksum = checksum(*slot);
+    std::atomic_thread_fence(std::memory_order_release);
+    ++slot->sequence;
+    ++m_writes;
+    m_dirty = true;
+}
+
+void StateFile::sync() {
+    if (!m_map || !m_dirty) {
+        return;
+    }
+    m_dirty = false;
+#ifdef Q_OS_UNIX
+    // Asynchronous: the conversion thread does not wait for the disk
+    if (msync(m_map, static_cast<size_t>(fileSize()), MS_ASYNC) != 0) {
+        emit errorOccurred(QString("Cannot sync state file %1").arg(m_file.fileName()));
+    }
+#endif
+}
@@ -0,0 +1,117 @@
+#ifndef STATEFILE_H
+#define STATEFILE_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <vector>
+#include "snmpoids.h"
+#include "snmpvalue.h"
+#include "oidstore.h"
+
+/*
+Last decoded value of every object in a memory-mapped file, for a warm restart.
+The layout is fixed: a header and MAX_SLOTS slots of one object each, a new
+object takes a free slot once and every later change overwrites that slot in
+place (no write() call, no allocation, unchanged values are not written at all).
+The pages belong to the kernel, so a killed process loses nothing it wrote.
+A slot being written has an odd sequence number and every slot carries a
+checksum: a slot torn by a crash or a power loss is skipped on load instead
+of restoring garbage. Dirty pages are handed to the disk every syncIntervalMs.
+*/
+class StateFile : public QObject {
+    Q_OBJECT
+public:
+    static const int MAX_SLOTS = 256;
+    static const int DEFAULT_SYNC_INTERVAL_MS = 1000;
+
+    // One object, fixed size; native byte order (the file is not moved between hosts)
+    struct Slot {
+        uint32_t sequence;  // Odd while the slot is being written
+        uint32_t checksum;  // Of everything after it
+        int64_t updatedMs;  // Wall clock of the last change
+        SnmpOid oid;        // length 0 - free slot
+        uint8_t type;
+        uint8_t length;
+        uint8_t reserved;
+        uint32_t number;
+        char text[OidStore::MAX_STRING_LENGTH];
+
+        SnmpValue value() const {
+            SnmpValue v;
+            v.type = type;
+            v.number = number;
+            v.string = text;
+            v.length = length;
+            return v;
+        }
+    };
+
+    explicit StateFile(const QString &fileName, QObject *parent = nullptr);
+    ~StateFile();
+
+    /*
+    Map the file and load its valid slots; a missing file or one with another
+    layout is (re)created empty
+    Return: false if the file cannot be created or mapped (errorOccurred)
+    */
+    bool open();
+    bool isOpen() const { return m_slots != nullptr; }
+    QString fileName() const { return m_file.fileName(); }
+    // Period of the write-back of dirty pages, 0 - left to the kernel
+    void setSyncInterval(int intervalMs);
+
+    // Store value of oid into its slot if it changed (conversion thread)
+    void write(const SnmpOid &oid, const SnmpValue &value);
+
+    // Objects with a value, ordered by OID
+    int size() const { return static_cast<int>(m_index.size()); }
+    const Slot &at(int index) const { return m_slots[m_index[index].slot]; }
+
+    // Slots rewritten since open()
+    uint64_t writes() const { return m_writes; }
+    // Slots skipped by open() (torn or corrupted)
+    int discarded() const { return m_discarded; }
+    // Changes of new objects lost because every slot is taken
+    uint64_t dropped() const { return m_dropped; }
+
+public slots:
+    // Schedule the write-back of the pages changed since the last sync
+    void sync();
+
+signals:
+    void errorOccurred(const QString &error);
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotSize;
+        uint32_t slotCount;
+        uint32_t reserved;
+        int64_t createdMs;
+    };
+    struct IndexEntry {
+        SnmpOid oid;
+        int slot;
+    };
+    static const int HEADER_SIZE = 64; // Slots start on a cache line
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    Slot *m_slots = nullptr;
+    std::vector<IndexEntry> m_index;   // Sorted by OID
+    std::vector<int> m_free;           // Free slots, the lowest last
+    QTimer m_syncTimer;
+    bool m_dirty = false;
+    uint64_t m_writes = 0;
+    uint64_t m_dropped = 0;
+    int m_discarded = 0;
+
+    // Index of the first entry of m_index not less than oid
+    int lowerBound(const SnmpOid &oid) const;
+    static uint32_t checksum(const Slot &slot);
+    static qint64 fileSize();
+};
+
+#endif // STATEFILE_H
@@ -0,0 +1,222 @@
+#include "udpsender.h"
+#include <QDebug>
+#include <cstring>
+#include "log.h"
+#include "metrics.h"
+
+#ifdef Q_OS_LINUX
+#include <arpa/inet.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+UdpSender::UdpSender(int capacity, QObject *parent)
+    : QObject(parent), m_capacity(capacity > 0 ? capacity : DEFAULT_CAPACITY), m_socket(new QUdpSocket(this)), m_retryTimer(this) {
+    m_slots.resize(m_capacity);
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &UdpSender::flush);
+    m_clock.start();
+    m_buffers.resize(static_cast<size_t>(m_capacity) * MAX_DATAGRAM_SIZE);
+#ifdef Q_OS_LINUX
+    m_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        qWarning() << "UDP socket for sendmmsg unavailable, sending one datagram per call";
+    }
+    // Message headers point at their slot once, queue() only fills address and length
+    m_addresses.resize(m_capacity);
+    m_iovecs.resize(m_capacity);
+    m_messages.resize(m_capacity);
+    for (int i = 0; i < m_capacity; ++i) {
+        m_iovecs[i].iov_base = slotData(i);
+        m_iovecs[i].iov_len = 0;
+        memset(&m_messages[i], 0, sizeof(mmsghdr));
+        m_messages[i].msg_hdr.msg_name = &m_addresses[i];
+        m_messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        m_messages[i].msg_hdr.msg_iov = &m_iovecs[i];
+        m_messages[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+UdpSender::~UdpSender() {
+    flush();
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+void UdpSender::setRateLimit(int perSecond, int burst) {
+    m_rate = perSecond > 0 ? perSecond / 1000.0 : 0;
+    m_burst = burst > 0 ? burst : 1;
+    m_tokens = m_burst;
+}
+
+bool UdpSender::queue(const char *prefix, int prefixSize, const char *data, int size, const QHostAddress &address, quint16 port,
+                      int64_t frameNs) {
+    if (prefixSize + size > MAX_DATAGRAM_SIZE) {
+        ++m_errors;
+        Metrics::add(METRIC_UDP_ERRORS);
+        reportError(QString("Datagram of %1 bytes does not fit into a send slot").arg(prefixSize + size));
+        return false;
+    }
+    if (m_count == m_capacity) {
+        flush();
+        if (m_count == m_capacity) {
+            // Rate limit or kernel buffer: give up the oldest datagram
+            ++m_dropped;
+            Metrics::add(METRIC_UDP_ERRORS);
+            LOG_WARNING(LOG_NET, "Send ring full, dropping the oldest datagram");
+            m_head = (m_head + 1) % m_capacity;
+            --m_count;
+        }
+    }
+
+    int index = (m_head + m_count) % m_capacity;
+    Slot &slot = m_slots[index];
+    char *slotBytes = slotData(index);
+    if (prefixSize > 0) {
+        memcpy(slotBytes, prefix, prefixSize);
+    }
+    memcpy(slotBytes + prefixSize, data, size);
+    size += prefixSize;
+    slot.address = address;
+    slot.port = port;
+    slot.size = size;
+    slot.frameNs = frameNs;
+    slot.ipv4 = address.protocol() == QAbstractSocket::IPv4Protocol;
+#ifdef Q_OS_LINUX
+    if (slot.ipv4) {
+        sockaddr_in &target = m_addresses[index];
+        target.sin_family = AF_INET;
+        target.sin_port = htons(port);
+        target.sin_addr.s_addr = htonl(address.toIPv4Address());
+        m_iovecs[index].iov_len = static_cast<size_t>(size);
+    }
+#endif
+    ++m_count;
+    return true;
+}
+
+void UdpSender::flush() {
+    // Datagrams the rate limit allows now
+    int budget = m_count;
+    if (m_rate > 0) {
+        qint64 now = m_clock.elapsed();
+        m_tokens += (now - m_lastRefillMs) * m_rate;
+        m_lastRefillMs = now;
+        if (m_tokens > m_burst) {
+            m_tokens = m_burst;
+        }
+        budget = static_cast<int>(m_tokens);
+    }
+
+    int64_t start = Metrics::now();
+    int sentTotal = 0;
+    while (m_count > 0 && sentTotal < budget) {
+        int consumed = 0;
+        if (m_sink) {
+            const Slot &slot = m_slots[m_head];
+            m_sink->write(slotData(m_head), slot.size, slot.address, slot.port);
+            ++m_datagrams;
+            m_bytes += static_cast<uint64_t>(slot.size);
+            consumed = 1;
+        } else
+#ifdef Q_OS_LINUX
+        if (m_fd >= 0 && m_slots[m_head].ipv4) {
+            // Longest run of IPv4 slots that does not wrap around the ring
+            int run = 0;
+            while (run < m_count && run < budget - sentTotal && m_head + run < m_capacity && m_slots[m_head + run].ipv4) {
+                ++run;
+            }
+            consumed = sendBatch(run);
+        } else
+#endif
+        {
+            consumed = writeOne() ? 1 : 0;
+        }
+        if (consumed == 0) {
+            break; // Socket buffer full, retried by the timer
+        }
+        // End to end: the frames of these datagrams are out (or given up) only now
+        int64_t sentNs = Metrics::now();
+        for (int i = 0; i < consumed; ++i) {
+            int64_t frameNs = m_slots[(m_head + i) % m_capacity].frameNs;
+            if (frameNs != 0) {
+                Metrics::record(STAGE_END_TO_END, sentNs - frameNs);
+            }
+        }
+        m_head = (m_head + consumed) % m_capacity;
+        m_count -= consumed;
+        sentTotal += consumed;
+    }
+    if (m_rate > 0) {
+        m_tokens -= sentTotal;
+    }
+    if (sentTotal > 0) {
+        Metrics::add(METRIC_DATAGRAMS_SENT, static_cast<uint64_t>(sentTotal));
+        Metrics::record(STAGE_SEND, Metrics::now() - start);
+    }
+
+    if (m_count > 0 && !m_retryTimer.isActive()) {
+        // Next token (rate limit) or another try after EAGAIN
+        int interval = RETRY_INTERVAL_MS;
+        if (m_rate > 0 && sentTotal == budget) {
+            interval = static_cast<int>((1.0 - m_tokens) / m_rate) + 1; // m_tokens < 1 here
+        }
+        m_retryTimer.start(interval);
+    }
+}
+
+int UdpSender::sendBatch(int count) {
+#ifdef Q_OS_LINUX
+    int sent;
+    do {
+        ++m_syscalls;
+        sent = ::sendmmsg(m_fd, &m_messages[m_head], static_cast<unsigned int>(count), 0);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent > 0) {
+        m_datagrams += static_cast<uint64_t>(sent);
+        for (int i = 0; i < sent; ++i) {
+            m_bytes += m_messages[m_head + i].msg_len; // Set by the kernel
+        }
+        LOG_TRACE(LOG_NET, "sendmmsg: {} of {} datagrams", sent, count);
+        return sent;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+    }
+    // The first datagram was rejected (unreachable, too big ...): skip it
+    ++m_errors;
+    Metrics::add(METRIC_UDP_ERRORS);
+    reportError(QString("UDP send failed: ") + strerror(errno));
+    return 1;
+#else
+    Q_UNUSED(count);
+    return writeOne() ? 1 : 0;
+#endif
+}
+
+bool UdpSender::writeOne() {
+    const Slot &slot = m_slots[m_head];
+    ++m_syscalls;
+    if (m_socket->writeDatagram(slotData(m_head), slot.size, slot.address, slot.port) == -1) {
+        if (m_socket->error() == QAbstractSocket::TemporaryError) {
+            return false;
+        }
+        ++m_errors;
+        Metrics::add(METRIC_UDP_ERRORS);
+        reportError("UDP send failed: " + m_socket->errorString());
+        return true;
+    }
+    ++m_datagrams;
+    m_bytes += static_cast<uint64_t>(slot.size);
+    return true;
+}
+
+void UdpSender::reportError(const QString &err) {
+    qWarning() << err;
+    emit errorOccurred(err);
+}
@@ -0,0 +1,135 @@
+#ifndef UDPSENDER_H
+#define UDPSENDER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <vector>
+#include "snmppdu.h"
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+/*
+Receives the datagrams instead of the socket (benchmarks, replay): only the
+CPU cost of the pipeline is measured and the output can be compared.
+*/
+class DatagramSink {
+public:
+    virtual ~DatagramSink() {}
+    virtual void write(const char *data, int size, const QHostAddress &address, quint16 port) = 0;
+};
+
+/*
+Outbound datagram batcher.
+queue() copies an encoded message into a preallocated ring slot and returns;
+flush() sends everything queued with one sendmmsg() call on Linux (up to
+capacity datagrams per syscall), elsewhere (and for IPv6 destinations) with
+one QUdpSocket::writeDatagram() per datagram. A full ring is flushed before
+the next datagram is queued. If the kernel socket buffer is full (EAGAIN) the
+rest stays queued and is retried by a timer; a datagram the kernel rejects is
+counted as an error and skipped.
+With a rate limit (token bucket) flush() sends only what the bucket allows,
+the rest waits in the ring for the timer; a ring that is still full drops its
+oldest datagram, so a slow destination only loses its own data.
+Not thread-safe: used from the converter thread only.
+*/
+class UdpSender : public QObject {
+    Q_OBJECT
+public:
+    static const int DEFAULT_CAPACITY = 64;
+    // Largest datagram a slot holds
+    static const int MAX_DATAGRAM_SIZE = SnmpPduBuilder::MAX_MESSAGE_SIZE;
+
+    explicit UdpSender(int capacity = DEFAULT_CAPACITY, QObject *parent = nullptr);
+    ~UdpSender();
+
+    // Datagrams per second, 0 - unlimited
+    void setRateLimit(int perSecond, int burst);
+    // Hand datagrams to sink instead of the socket (nullptr - socket), not owned
+    void setSink(DatagramSink *sink) { m_sink = sink; }
+
+    // Copy the datagram into the ring; false if it is larger than MAX_DATAGRAM_SIZE
+    bool queue(const char *data, int size, const QHostAddress &address, quint16 port) {
+        return queue(nullptr, 0, data, size, address, port);
+    }
+    /*
+    Same, datagram = prefix followed by data (per-destination header + shared PDU).
+    frameNs: Metrics::now() of the read that delivered the oldest frame of the
+    message, recorded as STAGE_END_TO_END when the datagram leaves (0 - not recorded)
+    */
+    bool queue(const char *prefix, int prefixSize, const char *data, int size, const QHostAddress &address, quint16 port,
+               int64_t frameNs = 0);
+    int pending() const { return m_count; }
+    int capacity() const { return m_capacity; }
+
+    // Statistics
+    uint64_t datagrams() const { return m_datagrams; }
+    // Payload bytes of the datagrams sent
+    uint64_t bytes() const { return m_bytes; }
+    uint64_t syscalls() const { return m_syscalls; }
+    uint64_t errors() const { return m_errors; }
+    // Overwritten in a full ring (rate limited or unreachable destination)
+    uint64_t dropped() const { return m_dropped; }
+    double datagramsPerSyscall() const { return m_syscalls ? static_cast<double>(m_datagrams) / m_syscalls : 0.0; }
+
+public slots:
+    // Send what is queued (as far as the rate limit allows)
+    void flush();
+
+signals:
+    void errorOccurred(const QString &err);
+
+private:
+    // Retry period after EAGAIN
+    static const int RETRY_INTERVAL_MS = 10;
+
+    struct Slot {
+        QHostAddress address; // Used by the writeDatagram() path
+        quint16 port;
+        bool ipv4;
+        int size;
+        int64_t frameNs;      // For STAGE_END_TO_END, 0 - none
+    };
+
+    int m_capacity;
+    std::vector<Slot> m_slots;
+    std::vector<char> m_buffers; // capacity * MAX_DATAGRAM_SIZE, slot i at i * MAX_DATAGRAM_SIZE
+    int m_head = 0;              // Oldest queued slot
+    int m_count = 0;
+    QUdpSocket *m_socket;        // Fallback path
+    QTimer m_retryTimer;         // Sends what flush() left in the ring
+    DatagramSink *m_sink = nullptr;
+
+    double m_rate = 0;           // Tokens per ms, 0 - unlimited
+    double m_burst = 0;
+    double m_tokens = 0;
+    qint64 m_lastRefillMs = 0;
+    QElapsedTimer m_clock;
+
+#ifdef Q_OS_LINUX
+    int m_fd = -1;
+    std::vector<sockaddr_in> m_addresses;
+    std::vector<iovec> m_iovecs;
+    std::vector<mmsghdr> m_messages;
+#endif
+
+    uint64_t m_datagrams = 0;
+    uint64_t m_bytes = 0;
+    uint64_t m_syscalls = 0;
+    uint64_t m_errors = 0;
+    uint64_t m_dropped = 0;
+
+    char *slotData(int index) { return m_buffers.data() + static_cast<size_t>(index) * MAX_DATAGRAM_SIZE; }
+    // Send the oldest slot with writeDatagram(); false if it has to be retried later
+    bool writeOne();
+    // Send up to count contiguous slots from m_head with sendmmsg(); number of slots consumed, 0 to stop
+    int sendBatch(int count);
+    void reportError(const QString &err);
+};
+
+#endif // UDPSENDER_H
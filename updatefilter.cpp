@@ -0,0 +1,194 @@
+#include "updatefilter.h"
+
+namespace {
+
+// Config keys indexed by UnitParam
+const char *const PARAM_NAMES[UNIT_PARAM_COUNT] = {
+    "status", "power", "reflectedPower", "temperature", "inputVoltage", "gain", "mute", "operatingIF",
+    "summaryAlarm", "outOfLockAlarm", "tempAlarm", "inputVoltageAlarm", "overPowerAlarm",
+    "alarmLog1", "alarmLog2", "alarmLog3"
+};
+
+bool sameOid(const SnmpOid &a, const SnmpOid &b) {
+    if (a.length != b.length) {
+        return false;
+    }
+    for (int i = 0; i < a.length; ++i) {
+        if (a.bytes[i] != b.bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Numeric value of an entry or update: INTEGER is signed, application types are unsigned
+double numericValue(uint8_t type, uint32_t number) {
+    return type == BER_INTEGER ? static_cast<double>(static_cast<int32_t>(number)) : static_cast<double>(number);
+}
+
+} // namespace
+
+UpdateFilter::UpdateFilter() {
+    m_entries.reserve(128);
+}
+
+void UpdateFilter::setDefaultRule(const FilterRule &rule) {
+    m_defaultRule = rule;
+    for (Entry &entry : m_entries) {
+        entry.rule = ruleFor(entry.oid);
+    }
+}
+
+void UpdateFilter::setRule(UnitParam param, const FilterRule &rule) {
+    m_paramRules[param] = rule;
+    m_paramRuleSet[param] = true;
+    for (Entry &entry : m_entries) {
+        entry.rule = ruleFor(entry.oid);
+    }
+}
+
+bool UpdateFilter::parseRule(const QString &text, FilterRule &rule) {
+    QString mode = text.section(':', 0, 0).trimmed();
+    if (mode.compare("always", Qt::CaseInsensitive) == 0) {
+        rule.mode = FILTER_ALWAYS;
+        rule.threshold = 0;
+        return true;
+    }
+    if (mode.compare("onChange", Qt::CaseInsensitive) == 0) {
+        rule.mode = FILTER_ON_CHANGE;
+        rule.threshold = 0;
+        return true;
+    }
+    bool ok = false;
+    double threshold = text.section(':', 1, 1).trimmed().toDouble(&ok);
+    if (!ok || threshold < 0) {
+        return false;
+    }
+    if (mode.compare("abs", Qt::CaseInsensitive) == 0) {
+        rule.mode = FILTER_DEADBAND_ABS;
+    } else if (mode.compare("percent", Qt::CaseInsensitive) == 0) {
+        rule.mode = FILTER_DEADBAND_PERCENT;
+    } else {
+        return false;
+    }
+    rule.threshold = threshold;
+    return true;
+}
+
+int UpdateFilter::paramFromName(const QString &name) {
+    for (int i = 0; i < UNIT_PARAM_COUNT; ++i) {
+        if (name.compare(PARAM_NAMES[i], Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+FilterRule UpdateFilter::ruleFor(const SnmpOid &oid) const {
+    // Runs once per new OID: find which parameter of which unit it is
+    for (int unit = 0; unit < SCI_UNIT_COUNT; ++unit) {
+        for (int param = 0; param < UNIT_PARAM_COUNT; ++param) {
+            if (m_paramRuleSet[param] && sameOid(UNIT_OIDS.oid[unit][param], oid)) {
+                return m_paramRules[param];
+            }
+        }
+    }
+    return m_defaultRule;
+}
+
+bool UpdateFilter::changed(const Entry &entry, const SnmpValue &value) {
+    if (entry.type != value.type) {
+        return true;
+    }
+    if (value.type == BER_OCTET_STRING) {
+        int length = value.length > MAX_STRING_LENGTH ? MAX_STRING_LENGTH : value.length;
+        if (entry.length != length) {
+            return true;
+        }
+        for (int i = 0; i < length; ++i) {
+            if (entry.text[i] != value.string[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double last = numericValue(entry.type, entry.number);
+    double current = numericValue(value.type, value.number);
+    double difference = current > last ? current - last : last - current;
+    switch (entry.rule.mode) {
+    case FILTER_ALWAYS:
+        return true;
+    case FILTER_ON_CHANGE:
+        return difference != 0;
+    case FILTER_DEADBAND_ABS:
+        return difference != 0 && difference >= entry.rule.threshold;
+    case FILTER_DEADBAND_PERCENT: {
+        double magnitude = last < 0 ? -last : last;
+        if (magnitude == 0) {
+            return difference != 0;
+        }
+        return difference * 100.0 >= entry.rule.threshold * magnitude;
+    }
+    }
+    return true;
+}
+
+void UpdateFilter::markSent(int position, const SnmpValue &value, int64_t nowMs) {
+    ++m_passed;
+    if (position >= 0) {
+        remember(m_entries[position], value, nowMs);
+    }
+}
+
+void UpdateFilter::remember(Entry &entry, const SnmpValue &value, int64_t nowMs) {
+    entry.sent = true;
+    entry.sentMs = nowMs;
+    entry.type = value.type;
+    entry.number = value.number;
+    int length = value.type == BER_OCTET_STRING ? value.length : 0;
+    if (length > MAX_STRING_LENGTH) {
+        length = MAX_STRING_LENGTH;
+    }
+    for (int i = 0; i < length; ++i) {
+        entry.text[i] = value.string[i];
+    }
+    entry.length = static_cast<uint8_t>(length);
+}
+
+bool UpdateFilter::shouldSend(const SnmpOid &oid, const SnmpValue &value, int64_t nowMs, int &position) {
+    position = -1;
+    if (!m_enabled) {
+        return true;
+    }
+
+    // Binary search for the OID
+    int low = 0;
+    int high = static_cast<int>(m_entries.size());
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (snmpOidCompare(m_entries[middle].oid, oid) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == static_cast<int>(m_entries.size()) || snmpOidCompare(m_entries[low].oid, oid) != 0) {
+        // First value of this object is always sent
+        Entry entry{};
+        entry.oid = oid;
+        entry.rule = ruleFor(oid);
+        m_entries.insert(m_entries.begin() + low, entry);
+        position = low;
+        return true;
+    }
+
+    Entry &entry = m_entries[low];
+    bool refresh = m_refreshIntervalMs > 0 && nowMs - entry.sentMs >= m_refreshIntervalMs;
+    if (!entry.sent || refresh || changed(entry, value)) {
+        position = low;
+        return true;
+    }
+    ++m_suppressed;
+    return false;
+}
@@ -0,0 +1,101 @@
+#ifndef UPDATEFILTER_H
+#define UPDATEFILTER_H
+
+#include <cstdint>
+#include <vector>
+#include <QString>
+#include "snmpoids.h"
+#include "snmpvalue.h"
+
+/*
+Suppression rule of one object:
+>FILTER_ALWAYS - send every update
+>FILTER_ON_CHANGE - send when the value differs from the last sent one
+>FILTER_DEADBAND_ABS - send when |value - last sent| >= threshold
+>FILTER_DEADBAND_PERCENT - send when |value - last sent| >= threshold % of |last sent|
+*/
+enum FilterMode {
+    FILTER_ALWAYS,
+    FILTER_ON_CHANGE,
+    FILTER_DEADBAND_ABS,
+    FILTER_DEADBAND_PERCENT
+};
+
+struct FilterRule {
+    FilterMode mode = FILTER_ON_CHANGE;
+    double threshold = 0;
+};
+
+/*
+Change detection before values are put into outgoing SNMP messages.
+Keeps the last sent value of every OID (sorted vector, fixed-size entries)
+and lets an update through only if its rule says so or if the object was
+not sent for refreshInterval (forced refresh, so a lost datagram is
+eventually repaired). Rules are set per UnitParam (the same for PA A/B/C);
+unit-independent objects use the default rule.
+*/
+class UpdateFilter {
+public:
+    // Longest OCTET STRING compared in full (longer ones compare by prefix and length)
+    static const int MAX_STRING_LENGTH = 32;
+    static const int DEFAULT_REFRESH_INTERVAL_MS = 300000;
+
+    UpdateFilter();
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+    // Send unchanged values again after this time, 0 - never
+    void setRefreshInterval(int intervalMs) { m_refreshIntervalMs = intervalMs; }
+    int refreshInterval() const { return m_refreshIntervalMs; }
+    void setDefaultRule(const FilterRule &rule);
+    void setRule(UnitParam param, const FilterRule &rule);
+
+    /*
+    Parse "always", "onChange", "abs:<threshold>" or "percent:<threshold>"
+    Return: false if the text is not a rule
+    */
+    static bool parseRule(const QString &text, FilterRule &rule);
+    // Config key of the parameter ("temperature", "power", ...), -1 if unknown
+    static int paramFromName(const QString &name);
+
+    /*
+    Decide whether the update has to be sent, nowMs - monotonic time in milliseconds.
+    Nothing is recorded yet: once the value is in a message, markSent(position) makes it
+    the last sent value, so a value that could not be sent is not suppressed later
+    */
+    bool shouldSend(const SnmpOid &oid, const SnmpValue &value, int64_t nowMs, int &position);
+    // Value passed by the last shouldSend() went out; position as returned by it
+    void markSent(int position, const SnmpValue &value, int64_t nowMs);
+
+    // Updates sent / suppressed
+    uint64_t passed() const { return m_passed; }
+    uint64_t suppressed() const { return m_suppressed; }
+
+private:
+    struct Entry {
+        SnmpOid oid;
+        FilterRule rule;
+        int64_t sentMs;
+        bool sent;            // false: seen, but no value has gone out yet
+        uint32_t number;
+        uint8_t type;
+        uint8_t length;
+        char text[MAX_STRING_LENGTH];
+    };
+
+    bool m_enabled = false;
+    int m_refreshIntervalMs = DEFAULT_REFRESH_INTERVAL_MS;
+    FilterRule m_defaultRule;
+    FilterRule m_paramRules[UNIT_PARAM_COUNT];
+    bool m_paramRuleSet[UNIT_PARAM_COUNT] = {};
+    std::vector<Entry> m_entries; // Sorted by OID
+    uint64_t m_passed = 0;
+    uint64_t m_suppressed = 0;
+
+    FilterRule ruleFor(const SnmpOid &oid) const;
+    // The value differs enough from the entry to be sent
+    static bool changed(const Entry &entry, const SnmpValue &value);
+    static void remember(Entry &entry, const SnmpValue &value, int64_t nowMs);
+};
+
+#endif // UPDATEFILTER_H